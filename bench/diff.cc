@@ -0,0 +1,77 @@
+#include <chrono>
+#include <format>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <string_view>
+
+#include "diff.h"
+
+using namespace mempatcher;
+
+/**
+ * Measure how long finding the differing runs between two images of different sizes takes.
+ *
+ * Each pair differs in a short run every 64 KiB, roughly what a heavily patched
+ * build looks like, so the time is dominated by skipping identical bytes.
+ *
+ * Usage: mempatcher_diff_bench [--runs <count>]
+ */
+
+/**
+ * Build a pair of buffers that differ in a few bytes at regular intervals.
+ *
+ * @param size Size of each buffer.
+ * @return Original and modified buffers.
+ */
+auto make_pair(std::size_t size) -> std::pair<std::vector<std::uint8_t>, std::vector<std::uint8_t>>
+{
+    auto random = std::mt19937 { 1 };
+    auto a = std::vector<std::uint8_t>(size);
+
+    std::ranges::generate(a, [&] { return static_cast<std::uint8_t>(random()); });
+
+    auto b = a;
+
+    for (auto offset = std::size_t { 0x8000 }; offset + 4 < size; offset += 0x10000)
+        for (auto i = std::size_t {}; i < 4; ++i)
+            b[offset + i] ^= 0xFF;
+
+    return { std::move(a), std::move(b) };
+}
+
+auto main(int argc, char** argv) -> int
+{
+    auto runs = std::size_t { 10 };
+
+    for (auto i = 1; i + 1 < argc; ++i)
+        if (std::string_view { argv[i] } == "--runs")
+            runs = std::max<std::size_t>(std::strtoull(argv[++i], nullptr, 10), 1);
+
+    std::puts(std::format("{:>8} {:>12} {:>12} {:>12}", "MiB", "mean (ms)", "GiB/s", "runs found").c_str());
+
+    for (auto&& mib: { std::size_t { 1 }, std::size_t { 16 }, std::size_t { 128 } })
+    {
+        auto const size = mib * 1024 * 1024;
+        auto const [a, b] = make_pair(size);
+        auto elapsed = std::chrono::duration<double, std::milli> {};
+        auto found = std::size_t {};
+
+        for (auto run = std::size_t {}; run < runs; ++run)
+        {
+            auto const start = std::chrono::steady_clock::now();
+            found = diff::find_runs(a, b, 16).size();
+            elapsed += std::chrono::steady_clock::now() - start;
+        }
+
+        auto const mean = elapsed.count() / static_cast<double>(runs);
+        auto const rate = static_cast<double>(size) / (1024.0 * 1024.0 * 1024.0) / (mean / 1000.0);
+
+        std::puts(std::format("{:>8} {:>12.2f} {:>12.2f} {:>12}", mib, mean, rate, found).c_str());
+    }
+
+    return EXIT_SUCCESS;
+}
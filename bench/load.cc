@@ -0,0 +1,100 @@
+#include <chrono>
+#include <format>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <filesystem>
+
+#include <windows.h>
+
+/**
+ * Compare the file size and load time of mempatcher builds, e.g. the default
+ * spdlog build against one configured with MEMPATCHER_LOG_BACKEND=minimal.
+ *
+ * Each library is loaded without any patch files, so the time covers mapping
+ * the image, runtime and logger start-up and DllMain declining to stay loaded.
+ *
+ * Usage: mempatcher_bench [--runs <count>] <library> [<library>...]
+ */
+
+struct result
+{
+    std::uintmax_t size;
+    double mean;
+    double fastest;
+};
+
+/**
+ * Load and unload a library repeatedly and time each load.
+ *
+ * @param path Path to the library.
+ * @param runs Number of loads to time.
+ * @return File size and load times in microseconds.
+ */
+auto measure(const std::filesystem::path& path, std::size_t runs) -> result
+{
+    auto times = std::vector<double> {};
+
+    for (auto i = std::size_t {}; i < runs; ++i)
+    {
+        auto const start = std::chrono::steady_clock::now();
+        auto const module = LoadLibraryW(path.c_str());
+        auto const end = std::chrono::steady_clock::now();
+
+        // mempatcher refuses to stay loaded without patches, but is kept if a build does
+        if (module)
+            FreeLibrary(module);
+
+        times.push_back(std::chrono::duration<double, std::micro> { end - start }.count());
+    }
+
+    auto total = 0.0;
+
+    for (auto&& time: times)
+        total += time;
+
+    return { file_size(path), total / static_cast<double>(runs), std::ranges::min(times) };
+}
+
+auto main(int argc, char** argv) -> int
+{
+    auto runs = std::size_t { 200 };
+    auto paths = std::vector<std::filesystem::path> {};
+
+    for (auto i = 1; i < argc; ++i)
+    {
+        auto const arg = std::string { argv[i] };
+
+        if (arg == "--runs" && i + 1 < argc)
+            runs = std::max(std::strtoull(argv[++i], nullptr, 10), 1ull);
+        else
+            paths.emplace_back(arg);
+    }
+
+    if (paths.empty())
+    {
+        std::fputs("usage: mempatcher_bench [--runs <count>] <library> [<library>...]\n", stderr);
+        return EXIT_FAILURE;
+    }
+
+    std::puts(std::format("{:<40} {:>12} {:>12} {:>12}", "library", "size", "mean (us)", "min (us)").c_str());
+
+    for (auto&& path: paths)
+    {
+        if (!exists(path))
+        {
+            std::fputs(std::format("'{}' does not exist\n", path.string()).c_str(), stderr);
+            return EXIT_FAILURE;
+        }
+
+        // the first load pulls the file into the page cache and is not counted
+        measure(path, 1);
+
+        auto const [size, mean, fastest] = measure(path, runs);
+        std::puts(std::format("{:<40} {:>12} {:>12.1f} {:>12.1f}", path.string(), size, mean, fastest).c_str());
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+#include <chrono>
+#include <format>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <string_view>
+
+#include "alloc.h"
+#include "parser.h"
+#include "../test/heap.h"
+
+using namespace mempatcher;
+
+/**
+ * Measure the time and allocations needed to parse patch files of different sizes.
+ *
+ * Reports the patches the parser hands out through the counting resource, and
+ * every heap allocation per parsed line, including temporaries freed while parsing.
+ *
+ * Usage: mempatcher_parse_bench [--runs <count>]
+ */
+
+/**
+ * Build patch file contents with a number of lines for the same target.
+ *
+ * @param lines Number of patch lines.
+ * @return Patch file contents.
+ */
+auto make_patch_text(std::size_t lines) -> std::string
+{
+    auto result = std::string {};
+
+    for (auto i = std::size_t {}; i < lines; ++i)
+        result += std::format("bm2dx.dll F+{:X} 9090E9???????? 7407E9????????\n", 0x1000 + i * 0x10);
+
+    return result;
+}
+
+auto main(int argc, char** argv) -> int
+{
+    auto runs = std::size_t { 20 };
+
+    for (auto i = 1; i + 1 < argc; ++i)
+        if (std::string_view { argv[i] } == "--runs")
+            runs = std::max<std::size_t>(std::strtoull(argv[++i], nullptr, 10), 1);
+
+    std::puts(std::format("{:>8} {:>12} {:>12} {:>12} {:>12} {:>12} {:>12}",
+        "lines", "mean (us)", "allocs", "bytes", "peak", "heap/line", "bytes/line").c_str());
+
+    for (auto&& lines: { std::size_t { 10 }, std::size_t { 1000 }, std::size_t { 100000 } })
+    {
+        auto const text = make_patch_text(lines);
+        auto resource = alloc::counting_resource {};
+        auto elapsed = std::chrono::duration<double, std::micro> {};
+        auto const before = test::heap::allocated();
+
+        for (auto run = std::size_t {}; run < runs; ++run)
+        {
+            auto const phase = alloc::phase { resource, "parse" };
+            auto const start = std::chrono::steady_clock::now();
+            auto const patches = parser::read_buffer(text, "bench.mph", &resource);
+
+            elapsed += std::chrono::steady_clock::now() - start;
+
+            if (!patches || patches->size() != lines)
+            {
+                std::fputs("failed to parse generated patches\n", stderr);
+                return EXIT_FAILURE;
+            }
+        }
+
+        auto const after = test::heap::allocated();
+        auto const parsed = static_cast<double>(lines * runs);
+
+        // every run parses the same text, so the first phase stands for all of them
+        auto const used = resource.phases().front().used;
+
+        std::puts(std::format("{:>8} {:>12.1f} {:>12} {:>12} {:>12} {:>12.2f} {:>12.1f}", lines,
+            elapsed.count() / static_cast<double>(runs), used.count, used.bytes, used.peak,
+            static_cast<double>(after.count - before.count) / parsed,
+            static_cast<double>(after.bytes - before.bytes) / parsed).c_str());
+    }
+
+    return EXIT_SUCCESS;
+}
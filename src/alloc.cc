@@ -0,0 +1,132 @@
+#include <utility>
+#include <algorithm>
+
+#include "alloc.h"
+
+using namespace mempatcher;
+using namespace mempatcher::alloc;
+
+/**
+ * @param upstream Resource that allocations are passed on to.
+ */
+counting_resource::counting_resource(std::pmr::memory_resource* upstream):
+    upstream { upstream } {}
+
+/**
+ * @return Allocations and bytes since construction or the last reset, and the
+ *         most bytes that were allocated at once in that time.
+ */
+auto counting_resource::total() const -> usage
+{
+    auto const guard = std::scoped_lock { lock };
+    return counted;
+}
+
+/**
+ * @return Bytes currently allocated through this resource.
+ */
+auto counting_resource::live() const -> std::size_t
+{
+    auto const guard = std::scoped_lock { lock };
+    return current;
+}
+
+/**
+ * @return Usage of every finished phase, in the order they finished.
+ */
+auto counting_resource::phases() const -> std::vector<phase_record>
+{
+    auto const guard = std::scoped_lock { lock };
+    return records;
+}
+
+/**
+ * Start counting from zero and forget finished phases. Memory that is still
+ * allocated stays counted as live and as the new peak.
+ */
+auto counting_resource::reset() -> void
+{
+    auto const guard = std::scoped_lock { lock };
+
+    counted = { .count = 0, .bytes = 0, .peak = current };
+    phase_peak = current;
+    records.clear();
+}
+
+auto counting_resource::do_allocate(std::size_t bytes, std::size_t alignment) -> void*
+{
+    // only count allocations that succeeded
+    auto const result = upstream->allocate(bytes, alignment);
+    auto const guard = std::scoped_lock { lock };
+
+    current += bytes;
+    counted.count += 1;
+    counted.bytes += bytes;
+    counted.peak = std::max(counted.peak, current);
+    phase_peak = std::max(phase_peak, current);
+
+    return result;
+}
+
+auto counting_resource::do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) -> void
+{
+    upstream->deallocate(pointer, bytes, alignment);
+
+    auto const guard = std::scoped_lock { lock };
+    current -= bytes;
+}
+
+auto counting_resource::do_is_equal(const std::pmr::memory_resource& other) const noexcept -> bool
+    { return this == &other; }
+
+/**
+ * Start recording a phase.
+ *
+ * @param resource Resource to record.
+ * @param name Name the usage is recorded under once the phase ends.
+ */
+phase::phase(counting_resource& resource, std::string_view name):
+    resource { resource }, name { name }
+{
+    auto const guard = std::scoped_lock { resource.lock };
+
+    start = resource.counted;
+    outer_peak = std::exchange(resource.phase_peak, resource.current);
+}
+
+/**
+ * Finish the phase and add its usage to the resource, unless it was discarded,
+ * keeping the peak of any enclosing phase.
+ */
+phase::~phase()
+{
+    auto const used = this->used();
+    auto const guard = std::scoped_lock { resource.lock };
+
+    resource.phase_peak = std::max(outer_peak, resource.phase_peak);
+
+    if (kept)
+        resource.records.push_back({ .name = std::move(name), .used = used });
+}
+
+/**
+ * @return Allocations and bytes since the phase started, and the most bytes
+ *         allocated through the resource at once during it.
+ */
+auto phase::used() const -> usage
+{
+    auto const guard = std::scoped_lock { resource.lock };
+
+    return {
+        .count = resource.counted.count - start.count,
+        .bytes = resource.counted.bytes - start.bytes,
+        .peak = resource.phase_peak
+    };
+}
+
+/**
+ * Leave the phase out of the records once it ends, for phases that are only logged
+ * and would otherwise add a record every time they run.
+ */
+auto phase::discard() -> void
+    { kept = false; }
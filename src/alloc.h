@@ -0,0 +1,80 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <string_view>
+#include <memory_resource>
+
+namespace mempatcher::alloc
+{
+    struct usage
+    {
+        std::size_t count;
+        std::size_t bytes;
+        std::size_t peak;
+    };
+
+    struct phase_record
+    {
+        std::string name;
+        usage used;
+    };
+
+    /**
+     * Memory resource that counts what passes through it before handing it upstream.
+     *
+     * Keeps the number of allocations, the total bytes requested, the bytes still
+     * allocated and the most that were allocated at once, overall and per phase.
+     */
+    class counting_resource: public std::pmr::memory_resource
+    {
+    public:
+        explicit counting_resource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+
+        [[nodiscard]] auto total() const -> usage;
+        [[nodiscard]] auto live() const -> std::size_t;
+        [[nodiscard]] auto phases() const -> std::vector<phase_record>;
+
+        auto reset() -> void;
+
+    private:
+        friend class phase;
+
+        std::pmr::memory_resource* upstream;
+        mutable std::mutex lock;
+        usage counted {};
+        std::size_t current {};
+        std::size_t phase_peak {};
+        std::vector<phase_record> records;
+
+        auto do_allocate(std::size_t bytes, std::size_t alignment) -> void* override;
+        auto do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) -> void override;
+        auto do_is_equal(const std::pmr::memory_resource& other) const noexcept -> bool override;
+    };
+
+    /**
+     * Records what a resource allocates from construction until destruction
+     * under a name. Phases can be nested, each one counts everything below it.
+     */
+    class phase
+    {
+    public:
+        phase(counting_resource& resource, std::string_view name);
+        ~phase();
+
+        phase(const phase&) = delete;
+        auto operator=(const phase&) -> phase& = delete;
+
+        [[nodiscard]] auto used() const -> usage;
+        auto discard() -> void;
+
+    private:
+        counting_resource& resource;
+        std::string name;
+        usage start;
+        std::size_t outer_peak;
+        bool kept { true };
+    };
+}
@@ -0,0 +1,209 @@
+#include <atomic>
+#include <cstring>
+
+#include "atomic.h"
+
+#if defined(_MSC_VER) && defined(_M_X64)
+    #include <intrin.h>
+    #define MEMPATCHER_CAS16
+#elif defined(__GNUC__) && defined(__x86_64__)
+    #define MEMPATCHER_CAS16
+#endif
+
+using namespace mempatcher;
+
+/**
+ * Compare and swap a 16-byte aligned block with 'cmpxchg16b'.
+ *
+ * @param block Pointer to the 16-byte aligned block.
+ * @param expected Expected contents, updated with the current contents on failure.
+ * @param desired Contents to store.
+ * @return True if the block was swapped, false otherwise.
+ */
+auto compare_exchange16(std::uint8_t* block, std::uint64_t (&expected)[2], const std::uint64_t (&desired)[2]) -> bool
+{
+#if defined(MEMPATCHER_CAS16) && defined(_MSC_VER)
+    return _InterlockedCompareExchange128(reinterpret_cast<volatile long long*>(block),
+        static_cast<long long>(desired[1]), static_cast<long long>(desired[0]),
+        reinterpret_cast<long long*>(expected)) != 0;
+#elif defined(MEMPATCHER_CAS16)
+    auto result = false;
+
+    __asm__ __volatile__ ("lock cmpxchg16b %1"
+        : "=@ccz" (result), "+m" (*reinterpret_cast<unsigned __int128*>(block)),
+          "+a" (expected[0]), "+d" (expected[1])
+        : "b" (desired[0]), "c" (desired[1])
+        : "memory");
+
+    return result;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Merge bytes into the aligned word containing them with a single atomic operation.
+ *
+ * @tparam Word Unsigned integer type of the containing word.
+ * @param target Pointer to the first byte to replace.
+ * @param data Replacement bytes.
+ * @return True if the bytes fit in one word and were stored, false otherwise.
+ */
+template <typename Word>
+auto store_word(std::uint8_t* target, std::span<const std::uint8_t> data) -> bool
+{
+    auto const address = reinterpret_cast<std::uintptr_t>(target);
+    auto const offset = address % sizeof(Word);
+
+    if (offset + data.size() > sizeof(Word))
+        return false;
+
+    auto const word = std::atomic_ref { *reinterpret_cast<Word*>(address - offset) };
+
+    // whole word, no need to preserve neighbouring bytes
+    if (data.size() == sizeof(Word))
+    {
+        auto value = Word {};
+        std::memcpy(&value, data.data(), sizeof(Word));
+        word.store(value);
+        return true;
+    }
+
+    auto expected = word.load(std::memory_order_relaxed);
+    auto desired = expected;
+
+    do
+    {
+        desired = expected;
+        std::memcpy(reinterpret_cast<std::uint8_t*>(&desired) + offset, data.data(), data.size());
+    }
+    while (!word.compare_exchange_weak(expected, desired));
+
+    return true;
+}
+
+/**
+ * Merge bytes into the 16-byte aligned block containing them with 'cmpxchg16b'.
+ *
+ * @param target Pointer to the first byte to replace.
+ * @param data Replacement bytes.
+ * @return True if the bytes fit in one block and were stored, false otherwise.
+ */
+auto store_block(std::uint8_t* target, std::span<const std::uint8_t> data) -> bool
+{
+#ifdef MEMPATCHER_CAS16
+    auto const address = reinterpret_cast<std::uintptr_t>(target);
+    auto const offset = address % 16;
+    auto const block = reinterpret_cast<std::uint8_t*>(address - offset);
+
+    if (offset + data.size() > 16)
+        return false;
+
+    std::uint64_t expected[2] {};
+    std::uint64_t desired[2] {};
+
+    // a torn initial read only costs an extra iteration
+    std::memcpy(expected, block, sizeof(expected));
+
+    do
+    {
+        std::memcpy(desired, expected, sizeof(desired));
+        std::memcpy(reinterpret_cast<std::uint8_t*>(desired) + offset, data.data(), data.size());
+    }
+    while (!compare_exchange16(block, expected, desired));
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Store a fixed number of bytes with a single atomic operation.
+ * Naturally aligned sizes use a plain atomic store, anything else is merged
+ * into the smallest aligned word or block that contains it.
+ *
+ * @tparam Size Number of bytes to store.
+ * @param target Pointer to the first byte to replace.
+ * @param data Replacement bytes, exactly Size bytes long.
+ * @return True if the bytes were stored, false if no single atomic operation covers them.
+ */
+template <std::size_t Size>
+auto store_fixed(std::uint8_t* target, std::span<const std::uint8_t> data) -> bool
+{
+    if constexpr (Size == 1)
+    {
+        std::atomic_ref { *target }.store(data[0]);
+        return true;
+    }
+    else if constexpr (Size == 2)
+        return store_word<std::uint16_t>(target, data) || store_word<std::uint64_t>(target, data) || store_block(target, data);
+    else if constexpr (Size == 4)
+        return store_word<std::uint32_t>(target, data) || store_word<std::uint64_t>(target, data) || store_block(target, data);
+    else if constexpr (Size == 8)
+        return store_word<std::uint64_t>(target, data) || store_block(target, data);
+    else if constexpr (Size == 16)
+        return store_block(target, data);
+    else
+        return store_word<std::uint64_t>(target, data) || store_block(target, data);
+}
+
+/**
+ * Check whether a range can be written with a single atomic operation.
+ *
+ * @param target Pointer to the first byte.
+ * @param size Number of bytes.
+ * @return True if one aligned word or block contains the whole range.
+ */
+auto atomic::fits(const std::uint8_t* target, std::size_t size) -> bool
+{
+    auto const address = reinterpret_cast<std::uintptr_t>(target);
+
+    if (size <= 1 || address % 8 + size <= 8)
+        return true;
+
+#ifdef MEMPATCHER_CAS16
+    return address % 16 + size <= 16;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Store bytes with a single atomic operation, so no other thread can observe a partial write.
+ * Memory must already be writable.
+ *
+ * @param target Pointer to the first byte to replace.
+ * @param data Replacement bytes.
+ * @return True if the bytes were stored, false if they are too large or span too many words.
+ */
+auto atomic::store(std::uint8_t* target, std::span<const std::uint8_t> data) -> bool
+{
+    switch (data.size())
+    {
+        case 0:  return true;
+        case 1:  return store_fixed<1>(target, data);
+        case 2:  return store_fixed<2>(target, data);
+        case 4:  return store_fixed<4>(target, data);
+        case 8:  return store_fixed<8>(target, data);
+        case 16: return store_fixed<16>(target, data);
+        default:
+            if (data.size() > max_store)
+                return false;
+
+            return store_fixed<0>(target, data);
+    }
+}
+
+/**
+ * Write bytes atomically when possible, falling back to a plain copy.
+ * Memory must already be writable.
+ *
+ * @param target Pointer to the first byte to replace.
+ * @param data Replacement bytes.
+ */
+auto atomic::write(std::uint8_t* target, std::span<const std::uint8_t> data) -> void
+{
+    if (!store(target, data))
+        std::memcpy(target, data.data(), data.size());
+}
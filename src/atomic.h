@@ -0,0 +1,13 @@
+#pragma once
+
+#include <span>
+#include <cstdint>
+
+namespace mempatcher::atomic
+{
+    auto constexpr max_store = std::size_t { 16 };
+
+    [[nodiscard]] auto fits(const std::uint8_t* target, std::size_t size) -> bool;
+    [[nodiscard]] auto store(std::uint8_t* target, std::span<const std::uint8_t> data) -> bool;
+    auto write(std::uint8_t* target, std::span<const std::uint8_t> data) -> void;
+}
@@ -0,0 +1,224 @@
+#include <cctype>
+#include <format>
+#include <fstream>
+#include <sstream>
+
+#include "cache.h"
+
+using namespace mempatcher;
+using namespace mempatcher::cache;
+
+namespace mempatcher::cache::detail
+{
+    auto constexpr header = std::string_view { "mempatcher-cache 1" };
+    auto constexpr fnv_offset = std::uint64_t { 0xCBF29CE484222325 };
+    auto constexpr fnv_prime = std::uint64_t { 0x100000001B3 };
+
+    /**
+     * FNV-1a, which unlike std::hash gives the same result in every run.
+     */
+    struct fnv1a
+    {
+        std::uint64_t value { fnv_offset };
+
+        auto bytes(const void* data, std::size_t size) -> fnv1a&
+        {
+            for (auto i = std::size_t {}; i < size; ++i)
+                value = (value ^ static_cast<const std::uint8_t*>(data)[i]) * fnv_prime;
+
+            return *this;
+        }
+
+        template <typename T>
+        auto add(const T& field) -> fnv1a&
+            { return bytes(&field, sizeof(T)); }
+
+        // sizes are widened so 32 and 64-bit builds share cache files
+        auto add(std::size_t field) -> fnv1a&
+        {
+            auto const wide = static_cast<std::uint64_t>(field);
+            return bytes(&wide, sizeof(wide));
+        }
+
+        auto add(std::string_view field) -> fnv1a&
+            { return add(field.size()).bytes(field.data(), field.size()); }
+
+        auto add(const parser::data& field) -> fnv1a&
+        {
+            add(field.bytes.size()).bytes(field.bytes.data(), field.bytes.size());
+            add(field.mask.size()).bytes(field.mask.data(), field.mask.size());
+
+            for (auto&& fill: field.fills)
+                add(fill.offset).add(fill.count).add(fill.value);
+
+            return add(field.fills.size());
+        }
+    };
+
+    /**
+     * Module names are case-insensitive on Windows.
+     */
+    auto lowercase(std::string_view name) -> std::string
+    {
+        auto result = std::string { name };
+
+        for (auto& c: result)
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+        return result;
+    }
+}
+
+/**
+ * Hash everything that identifies a patch, so any edit to the line gives a different key.
+ *
+ * @param patch Patch to hash.
+ * @return Hash that is stable between runs.
+ */
+auto cache::hash(const parser::patch& patch) -> std::uint64_t
+{
+    auto result = detail::fnv1a {};
+
+    result.add(patch.type).add(patch.target).add(patch.library).add(patch.symbol)
+          .add(static_cast<std::uint64_t>(patch.address)).add(patch.on).add(patch.off);
+
+    if (patch.crc)
+        result.add(patch.crc->section).add(patch.crc->size).add(patch.crc->value);
+
+    return result.value;
+}
+
+/**
+ * Load a cache file. Missing files and malformed lines are ignored.
+ *
+ * @param path Path to the cache file.
+ * @return Cached entries, possibly empty.
+ */
+auto store::load(const std::filesystem::path& path) -> store
+{
+    auto result = store {};
+    auto file = std::ifstream { path };
+    auto line = std::string {};
+
+    if (!file || !std::getline(file, line) || line != detail::header)
+        return result;
+
+    while (std::getline(file, line))
+    {
+        auto fields = std::istringstream { line };
+        auto module = std::string {};
+        auto build = pe::build_id {};
+        auto patch = std::uint64_t {};
+        auto rva = std::uint64_t {};
+
+        if (!std::getline(fields, module, '\t'))
+            continue;
+
+        fields >> std::hex >> build.timestamp >> build.image_size >> build.checksum >> patch >> rva;
+
+        if (!fields || module.empty())
+            continue;
+
+        auto& entry = result.modules[detail::lowercase(module)];
+
+        // a file with several builds of one module keeps the last
+        if (entry.build != build)
+            entry = { .build = build, .rvas = {} };
+
+        entry.rvas[patch] = static_cast<std::uintptr_t>(rva);
+    }
+
+    return result;
+}
+
+/**
+ * Write the cache to a file, replacing it only once the new contents are complete.
+ *
+ * @param path Path to the cache file.
+ * @return True if the cache was written, false otherwise.
+ */
+auto store::save(const std::filesystem::path& path) -> bool
+{
+    auto temporary = path;
+    temporary += ".tmp";
+
+    {
+        auto file = std::ofstream { temporary, std::ios::trunc };
+
+        if (!file)
+            return false;
+
+        file << detail::header << '\n';
+
+        for (auto&& [module, entry]: modules)
+            for (auto&& [patch, rva]: entry.rvas)
+                file << std::format("{}\t{:08X} {:08X} {:08X} {:016X} {:X}\n", module, entry.build.timestamp,
+                    entry.build.image_size, entry.build.checksum, patch, static_cast<std::uint64_t>(rva));
+
+        if (!file.flush())
+            return false;
+    }
+
+    auto error = std::error_code {};
+    std::filesystem::rename(temporary, path, error);
+
+    if (error)
+        return false;
+
+    changed = false;
+    return true;
+}
+
+/**
+ * Find the cached RVA of a patch.
+ *
+ * @param key Module build the patch is applied to.
+ * @param patch Hash of the patch.
+ * @return Cached RVA, or nothing if the patch was not resolved for this build before.
+ */
+auto store::find(const key& key, std::uint64_t patch) const -> std::optional<std::uintptr_t>
+{
+    auto const module = modules.find(detail::lowercase(key.module));
+
+    if (module == modules.end() || module->second.build != key.build)
+        return std::nullopt;
+
+    auto const it = module->second.rvas.find(patch);
+    return it != module->second.rvas.end() ? std::optional { it->second }: std::nullopt;
+}
+
+/**
+ * Store the resolved RVA of a patch, dropping entries of any other build of the module.
+ *
+ * @param key Module build the patch is applied to.
+ * @param patch Hash of the patch.
+ * @param rva Resolved address relative to the module base.
+ */
+auto store::insert(const key& key, std::uint64_t patch, std::uintptr_t rva) -> void
+{
+    auto& entry = modules[detail::lowercase(key.module)];
+
+    if (entry.build != key.build)
+        entry = { .build = key.build, .rvas = {} };
+
+    auto const [it, inserted] = entry.rvas.try_emplace(patch, rva);
+
+    if (inserted || it->second != rva)
+    {
+        it->second = rva;
+        changed = true;
+    }
+}
+
+auto store::size() const -> std::size_t
+{
+    auto result = std::size_t {};
+
+    for (auto&& [_, entry]: modules)
+        result += entry.rvas.size();
+
+    return result;
+}
+
+auto store::dirty() const -> bool
+    { return changed; }
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+#include <unordered_map>
+
+#include "pe.h"
+#include "parser.h"
+
+namespace mempatcher::cache
+{
+    /**
+     * Identifies one build of a module. Any rebuild changes at least one of the header fields.
+     */
+    struct key
+    {
+        std::string module;
+        pe::build_id build;
+    };
+
+    [[nodiscard]] auto hash(const parser::patch& patch) -> std::uint64_t;
+
+    /**
+     * Resolved patch addresses from previous runs, stored as RVAs per module build.
+     *
+     * Only the most recent build of each module is kept, so entries for an
+     * older build are dropped as soon as a different build is resolved.
+     */
+    class store
+    {
+    public:
+        [[nodiscard]] static auto load(const std::filesystem::path& path) -> store;
+        auto save(const std::filesystem::path& path) -> bool;
+
+        [[nodiscard]] auto find(const key& key, std::uint64_t patch) const -> std::optional<std::uintptr_t>;
+        auto insert(const key& key, std::uint64_t patch, std::uintptr_t rva) -> void;
+
+        [[nodiscard]] auto size() const -> std::size_t;
+        [[nodiscard]] auto dirty() const -> bool;
+
+    private:
+        struct entry
+        {
+            pe::build_id build;
+            std::unordered_map<std::uint64_t, std::uintptr_t> rvas;
+        };
+
+        std::unordered_map<std::string, entry> modules;
+        bool changed {};
+    };
+}
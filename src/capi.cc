@@ -0,0 +1,288 @@
+#include <format>
+#include <new>
+#include <memory>
+#include <ranges>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+
+#include "glob.h"
+#include "patch.h"
+#include "parser.h"
+#include "mempatcher.h"
+
+#ifdef _WIN32
+    #include "process.h"
+#endif
+
+using namespace mempatcher;
+
+struct mempatcher_patch_set
+{
+    parser::patch_list patches;
+};
+
+struct mempatcher_context
+{
+    struct change
+    {
+        std::unique_ptr<memory::backend> memory;
+        patch::journal journal;
+    };
+
+    std::vector<std::unique_ptr<mempatcher_patch_set>> sets;
+    std::vector<change> changes;
+};
+
+namespace mempatcher::capi::detail
+{
+    /**
+     * Fill in an error record if the caller passed one.
+     */
+    auto set_error(mempatcher_error* error, int code, std::size_t line, std::string_view message) -> void
+    {
+        if (!error)
+            return;
+
+        auto const size = std::min(message.size(), sizeof(error->message) - 1);
+
+        error->code = code;
+        error->line = line;
+        std::memcpy(error->message, message.data(), size);
+        error->message[size] = '\0';
+    }
+
+    /**
+     * Report an exception caught at the C boundary, which must not let it through.
+     *
+     * @param error Error record to fill in, or null.
+     * @return Status to return to the caller.
+     */
+    auto internal_error(mempatcher_error* error) -> mempatcher_status
+    {
+        set_error(error, 0, 0, "Internal error");
+        return MEMPATCHER_INTERNAL_ERROR;
+    }
+
+    /**
+     * Create the memory backend for a module in the current process.
+     *
+     * @param base Pointer to the image base address.
+     * @param module Name of the module.
+     * @return Backend to apply patches through.
+     */
+    auto make_backend([[maybe_unused]] std::uint8_t* base, [[maybe_unused]] const char* module)
+        -> std::unique_ptr<memory::backend>
+    {
+#ifdef _WIN32
+        return std::make_unique<memory::process>();
+#else
+        // there is no loader to ask elsewhere, so the image is treated as a plain buffer
+        auto const image = pe::image::from_module(base);
+        auto result = std::make_unique<memory::buffer>(std::span { base, image.size() });
+        result->add_module(module, base);
+
+        return result;
+#endif
+    }
+}
+
+/**
+ * Parse the contents of a patch file from memory.
+ *
+ * @param text Patch file contents, not necessarily null-terminated.
+ * @param size Size of the contents in bytes.
+ * @param name Name recorded in place of a filename, or null.
+ * @param set Receives the parsed patches, to be freed or registered by the caller.
+ * @param error Receives details if parsing fails, or null.
+ * @return MEMPATCHER_OK if every line parsed, otherwise an error status.
+ */
+extern "C" auto mempatcher_parse(const char* text, size_t size, const char* name,
+    mempatcher_patch_set** set, mempatcher_error* error) -> mempatcher_status
+{
+    if ((!text && size != 0) || !set)
+        return MEMPATCHER_INVALID_ARGUMENT;
+
+    try
+    {
+        auto result = parser::read_buffer({ text, size }, name ? name: "<memory>");
+
+        if (!result)
+        {
+            auto const [ec, line] = result.error();
+            capi::detail::set_error(error, static_cast<int>(ec), line, parser::make_error_code(ec).message());
+
+            return MEMPATCHER_PARSE_FAILED;
+        }
+
+        *set = new mempatcher_patch_set { std::move(*result) };
+        return MEMPATCHER_OK;
+    }
+    catch (...)
+    {
+        return capi::detail::internal_error(error);
+    }
+}
+
+extern "C" auto mempatcher_patch_count(const mempatcher_patch_set* set) -> size_t
+    { return set ? set->patches.size(): 0; }
+
+extern "C" auto mempatcher_free_patch_set(mempatcher_patch_set* set) -> void
+    { delete set; }
+
+extern "C" auto mempatcher_create() -> mempatcher_context*
+    { return new (std::nothrow) mempatcher_context {}; }
+
+extern "C" auto mempatcher_destroy(mempatcher_context* context) -> void
+    { delete context; }
+
+/**
+ * Register a patch set with a context, so it is considered by later applies.
+ *
+ * @param context Context to register with.
+ * @param set Patch set from mempatcher_parse. Ownership passes to the context, and it is freed if registering fails.
+ * @return MEMPATCHER_OK if registered, otherwise an error status.
+ */
+extern "C" auto mempatcher_register(mempatcher_context* context, mempatcher_patch_set* set) -> mempatcher_status
+{
+    if (!context || !set)
+    {
+        delete set;
+        return MEMPATCHER_INVALID_ARGUMENT;
+    }
+
+    try
+    {
+        context->sets.emplace_back(set);
+        return MEMPATCHER_OK;
+    }
+    catch (...)
+    {
+        // growing the list failed before the context took the set
+        delete set;
+        return MEMPATCHER_INTERNAL_ERROR;
+    }
+}
+
+/**
+ * Apply every registered patch for a module as a single transaction.
+ *
+ * Targets are matched against the module name the same way as for loader
+ * notifications, including wildcards. If any patch fails, nothing is written.
+ *
+ * @param context Context holding the registered patch sets.
+ * @param module Name of the module, e.g. "bm2dx.dll".
+ * @param base Pointer to the image base address of the module.
+ * @param applied Receives the number of patches applied, or null.
+ * @param error Receives details if applying fails, or null.
+ * @return MEMPATCHER_OK if every matching patch was applied, otherwise an error status.
+ */
+extern "C" auto mempatcher_apply(mempatcher_context* context, const char* module, void* base,
+    size_t* applied, mempatcher_error* error) -> mempatcher_status
+{
+    if (!context || !module || !base)
+        return MEMPATCHER_INVALID_ARGUMENT;
+
+    try
+    {
+        // every distinct target is matched once, not once per patch
+        auto names = std::vector<std::string> {};
+        auto ids = std::unordered_map<std::string_view, std::size_t> {};
+
+        for (auto&& set: context->sets)
+            for (auto&& patch: set->patches)
+                if (ids.try_emplace(patch.target, names.size()).second)
+                    names.emplace_back(patch.target);
+
+        auto matched = std::vector<bool>(names.size());
+
+        for (auto&& id: glob::matcher { names }.match(module))
+            matched[id] = true;
+
+        auto const address = static_cast<std::uint8_t*>(base);
+        auto memory = capi::detail::make_backend(address, module);
+        auto transaction = patch::transaction { *memory };
+
+        for (auto&& set: context->sets)
+            for (auto&& patch: set->patches)
+                if (matched[ids.at(patch.target)])
+                    transaction.add(address, patch);
+
+        if (applied)
+            *applied = 0;
+
+        if (transaction.size() == 0)
+            return MEMPATCHER_OK;
+
+        if (!transaction.prepare())
+        {
+            auto const failed = transaction.failed();
+            capi::detail::set_error(error, 0, failed ? failed->line: 0,
+                failed ? std::format("Patch at {} could not be applied", failed->target_name()):
+                         std::string { "Patches could not be applied" });
+
+            return MEMPATCHER_APPLY_FAILED;
+        }
+
+        // reserved up front so recording a committed change cannot fail
+        context->changes.reserve(context->changes.size() + 1);
+
+        if (!transaction.commit())
+        {
+            capi::detail::set_error(error, 0, 0, "Patches could not be written");
+            return MEMPATCHER_APPLY_FAILED;
+        }
+
+        auto journal = patch::journal {};
+
+        try
+        {
+            journal = transaction.changes();
+        }
+        catch (...)
+        {
+            // a change that cannot be recorded could never be reverted
+            transaction.rollback();
+            throw;
+        }
+
+        context->changes.push_back({ .memory = std::move(memory), .journal = std::move(journal) });
+
+        if (applied)
+            *applied = transaction.size();
+
+        return MEMPATCHER_OK;
+    }
+    catch (...)
+    {
+        return capi::detail::internal_error(error);
+    }
+}
+
+/**
+ * Undo every apply made through a context, newest first.
+ *
+ * @param context Context to revert.
+ * @return MEMPATCHER_OK if memory was restored, otherwise an error status.
+ */
+extern "C" auto mempatcher_revert(mempatcher_context* context) -> mempatcher_status
+{
+    if (!context)
+        return MEMPATCHER_INVALID_ARGUMENT;
+
+    try
+    {
+        auto result = true;
+
+        for (auto&& change: context->changes | std::views::reverse)
+            result = patch::revert(*change.memory, change.journal) && result;
+
+        context->changes.clear();
+
+        return result ? MEMPATCHER_OK: MEMPATCHER_REVERT_FAILED;
+    }
+    catch (...)
+    {
+        return MEMPATCHER_INTERNAL_ERROR;
+    }
+}
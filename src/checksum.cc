@@ -0,0 +1,130 @@
+#include <array>
+
+#include "checksum.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    #define MEMPATCHER_CRC32C_SSE42
+    #include <nmmintrin.h>
+
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+        #define MEMPATCHER_TARGET_SSE42
+    #else
+        #include <cpuid.h>
+        #define MEMPATCHER_TARGET_SSE42 __attribute__((target("sse4.2")))
+    #endif
+#endif
+
+using namespace mempatcher;
+
+namespace mempatcher::checksum::detail
+{
+    auto constexpr polynomial = std::uint32_t { 0x82F63B78 };
+
+    auto constexpr table = [] ()
+    {
+        auto result = std::array<std::uint32_t, 256> {};
+
+        for (auto i = std::uint32_t {}; i < result.size(); ++i)
+        {
+            auto crc = i;
+
+            for (auto bit = 0; bit < 8; ++bit)
+                crc = (crc >> 1) ^ (crc & 1 ? polynomial: 0);
+
+            result[i] = crc;
+        }
+
+        return result;
+    } ();
+}
+
+/**
+ * Table-driven CRC32C for processors without SSE4.2.
+ *
+ * @param data Bytes to hash.
+ * @param crc Inverted running checksum.
+ * @return Updated inverted running checksum.
+ */
+auto crc32c_table(std::span<const std::uint8_t> data, std::uint32_t crc) -> std::uint32_t
+{
+    for (auto&& byte: data)
+        crc = checksum::detail::table[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+
+    return crc;
+}
+
+#ifdef MEMPATCHER_CRC32C_SSE42
+
+/**
+ * Check whether the processor supports the SSE4.2 'crc32' instruction.
+ *
+ * @return True if supported, false otherwise.
+ */
+auto has_sse42() -> bool
+{
+#if defined(_MSC_VER)
+    auto regs = std::array<int, 4> {};
+    __cpuid(regs.data(), 1);
+    return (regs[2] & (1 << 20)) != 0;
+#else
+    auto eax = 0u, ebx = 0u, ecx = 0u, edx = 0u;
+    return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_2) != 0;
+#endif
+}
+
+/**
+ * Hardware CRC32C using the SSE4.2 'crc32' instruction.
+ *
+ * @param data Bytes to hash.
+ * @param crc Inverted running checksum.
+ * @return Updated inverted running checksum.
+ */
+MEMPATCHER_TARGET_SSE42
+auto crc32c_sse42(std::span<const std::uint8_t> data, std::uint32_t crc) -> std::uint32_t
+{
+    auto it = data.data();
+    auto const end = it + data.size();
+
+    // align to the word size so the main loop uses aligned loads
+    while (it != end && reinterpret_cast<std::uintptr_t>(it) % sizeof(std::uintptr_t) != 0)
+        crc = _mm_crc32_u8(crc, *it++);
+
+#if defined(_M_X64) || defined(__x86_64__)
+    auto wide = static_cast<std::uint64_t>(crc);
+
+    for (; end - it >= 8; it += 8)
+        wide = _mm_crc32_u64(wide, *reinterpret_cast<const std::uint64_t*>(it));
+
+    crc = static_cast<std::uint32_t>(wide);
+#else
+    for (; end - it >= 4; it += 4)
+        crc = _mm_crc32_u32(crc, *reinterpret_cast<const std::uint32_t*>(it));
+#endif
+
+    while (it != end)
+        crc = _mm_crc32_u8(crc, *it++);
+
+    return crc;
+}
+
+#endif
+
+/**
+ * Calculate the CRC32C (Castagnoli) checksum of a block of memory.
+ *
+ * @param data Bytes to hash.
+ * @param crc Previous checksum when hashing in multiple parts, otherwise zero.
+ * @return Checksum of the data.
+ */
+auto checksum::crc32c(std::span<const std::uint8_t> data, std::uint32_t crc) -> std::uint32_t
+{
+#ifdef MEMPATCHER_CRC32C_SSE42
+    auto static const hardware = has_sse42();
+
+    if (hardware)
+        return ~crc32c_sse42(data, ~crc);
+#endif
+
+    return ~crc32c_table(data, ~crc);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <span>
+#include <cstdint>
+
+namespace mempatcher::checksum
+{
+    [[nodiscard]] auto crc32c(std::span<const std::uint8_t> data, std::uint32_t crc = 0) -> std::uint32_t;
+}
@@ -0,0 +1,144 @@
+#include <array>
+
+#include "compare.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+    #define MEMPATCHER_COMPARE_SSE2
+    #include <immintrin.h>
+
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+        #define MEMPATCHER_TARGET_AVX2
+    #else
+        #include <cpuid.h>
+        #define MEMPATCHER_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#endif
+
+using namespace mempatcher;
+
+/**
+ * Masked compare for the tail that does not fill a whole vector.
+ */
+auto masked_equal_scalar(const std::uint8_t* a, const std::uint8_t* b, const std::uint8_t* mask, std::size_t size) -> bool
+{
+    for (auto i = std::size_t {}; i < size; ++i)
+        if ((a[i] ^ b[i]) & mask[i])
+            return false;
+
+    return true;
+}
+
+#ifdef MEMPATCHER_COMPARE_SSE2
+
+/**
+ * Check whether the processor and operating system support AVX2.
+ *
+ * @return True if supported, false otherwise.
+ */
+auto has_avx2() -> bool
+{
+    auto constexpr osxsave = 1u << 27;
+    auto constexpr avx = 1u << 28;
+    auto constexpr avx2 = 1u << 5;
+
+#if defined(_MSC_VER)
+    auto regs = std::array<int, 4> {};
+    __cpuid(regs.data(), 0);
+
+    if (regs[0] < 7)
+        return false;
+
+    __cpuid(regs.data(), 1);
+    auto const features = static_cast<unsigned>(regs[2]);
+    __cpuidex(regs.data(), 7, 0);
+    auto const extended = static_cast<unsigned>(regs[1]);
+#else
+    auto eax = 0u, ebx = 0u, ecx = 0u, edx = 0u;
+
+    if (__get_cpuid_max(0, nullptr) < 7 || !__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return false;
+
+    auto const features = ecx;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    auto const extended = ebx;
+#endif
+
+    if ((features & (osxsave | avx)) != (osxsave | avx) || (extended & avx2) == 0)
+        return false;
+
+    // the operating system has to save the upper halves of the ymm registers
+#if defined(_MSC_VER)
+    return (_xgetbv(0) & 6) == 6;
+#else
+    auto low = 0u, high = 0u;
+    __asm__ ("xgetbv": "=a"(low), "=d"(high): "c"(0));
+    return (low & 6) == 6;
+#endif
+}
+
+/**
+ * Masked compare of 16 bytes per step with SSE2 'pcmpeqb'.
+ */
+auto masked_equal_sse2(const std::uint8_t* a, const std::uint8_t* b, const std::uint8_t* mask, std::size_t size) -> bool
+{
+    auto i = std::size_t {};
+
+    for (; i + 16 <= size; i += 16)
+    {
+        auto const m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + i));
+        auto const x = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)), m);
+        auto const y = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)), m);
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF)
+            return false;
+    }
+
+    return masked_equal_scalar(a + i, b + i, mask + i, size - i);
+}
+
+/**
+ * Masked compare of 32 bytes per step with AVX2 'vpcmpeqb'.
+ */
+MEMPATCHER_TARGET_AVX2
+auto masked_equal_avx2(const std::uint8_t* a, const std::uint8_t* b, const std::uint8_t* mask, std::size_t size) -> bool
+{
+    auto i = std::size_t {};
+
+    for (; i + 32 <= size; i += 32)
+    {
+        auto const m = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask + i));
+        auto const x = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)), m);
+        auto const y = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)), m);
+
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != -1)
+            return false;
+    }
+
+    return masked_equal_sse2(a + i, b + i, mask + i, size - i);
+}
+
+#endif
+
+/**
+ * Compare two buffers, ignoring every byte where the mask is zero.
+ *
+ * @param a First buffer.
+ * @param b Second buffer.
+ * @param mask 0xFF for bytes that have to match, 0x00 for bytes that are ignored.
+ * @param size Size of all three buffers in bytes.
+ * @return True if every unmasked byte is equal, false otherwise.
+ */
+auto compare::masked_equal(const std::uint8_t* a, const std::uint8_t* b, const std::uint8_t* mask, std::size_t size) -> bool
+{
+#ifdef MEMPATCHER_COMPARE_SSE2
+    auto static const wide = has_avx2();
+
+    if (wide)
+        return masked_equal_avx2(a, b, mask, size);
+
+    return masked_equal_sse2(a, b, mask, size);
+#else
+    return masked_equal_scalar(a, b, mask, size);
+#endif
+}
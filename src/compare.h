@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace mempatcher::compare
+{
+    [[nodiscard]] auto masked_equal(const std::uint8_t* a, const std::uint8_t* b, const std::uint8_t* mask, std::size_t size) -> bool;
+}
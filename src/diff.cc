@@ -0,0 +1,209 @@
+#include <bit>
+#include <format>
+#include <algorithm>
+
+#include "diff.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+    #define MEMPATCHER_DIFF_SSE2
+    #include <emmintrin.h>
+#endif
+
+using namespace mempatcher;
+using namespace mempatcher::diff;
+
+/**
+ * Find the first position where two buffers are equal or differ.
+ *
+ * Compares 64 bytes per iteration with SSE2 where available, so skipping the
+ * identical bulk of two large images stays limited by memory bandwidth.
+ *
+ * @tparam Equal True to find the first equal byte, false to find the first different byte.
+ * @param a First buffer.
+ * @param b Second buffer, at least as long as the first.
+ * @param from Position to start searching from.
+ * @return Position of the first match, or the size of the first buffer if there is none.
+ */
+template <bool Equal>
+auto scan(std::span<const std::uint8_t> a, std::span<const std::uint8_t> b, std::size_t from) -> std::size_t
+{
+    auto const size = a.size();
+    auto i = from;
+
+#ifdef MEMPATCHER_DIFF_SSE2
+    auto const mask = [&] (std::size_t offset)
+    {
+        auto const x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.data() + offset));
+        auto const y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b.data() + offset));
+        auto const equal = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)));
+
+        return Equal ? equal: ~equal & 0xFFFF;
+    };
+
+    for (; i + 64 <= size; i += 64)
+    {
+        auto const m0 = mask(i);
+        auto const m1 = mask(i + 16);
+        auto const m2 = mask(i + 32);
+        auto const m3 = mask(i + 48);
+
+        if ((m0 | m1 | m2 | m3) == 0)
+            continue;
+
+        auto const bits = std::uint64_t { m0 } | std::uint64_t { m1 } << 16 |
+                          std::uint64_t { m2 } << 32 | std::uint64_t { m3 } << 48;
+
+        return i + static_cast<std::size_t>(std::countr_zero(bits));
+    }
+
+    for (; i + 16 <= size; i += 16)
+        if (auto const m = mask(i))
+            return i + static_cast<std::size_t>(std::countr_zero(m));
+#endif
+
+    for (; i < size; ++i)
+        if ((a[i] == b[i]) == Equal)
+            return i;
+
+    return size;
+}
+
+/**
+ * Find the first position at or after an offset where two buffers differ.
+ *
+ * @param a First buffer.
+ * @param b Second buffer, at least as long as the first.
+ * @param from Position to start searching from.
+ * @return Position of the first difference, or the size of the first buffer if there is none.
+ */
+auto diff::next_mismatch(std::span<const std::uint8_t> a, std::span<const std::uint8_t> b, std::size_t from) -> std::size_t
+    { return scan<false>(a, b, from); }
+
+/**
+ * Find the first position at or after an offset where two buffers are equal.
+ *
+ * @param a First buffer.
+ * @param b Second buffer, at least as long as the first.
+ * @param from Position to start searching from.
+ * @return Position of the first equal byte, or the size of the first buffer if there is none.
+ */
+auto diff::next_match(std::span<const std::uint8_t> a, std::span<const std::uint8_t> b, std::size_t from) -> std::size_t
+    { return scan<true>(a, b, from); }
+
+/**
+ * Find every run of differing bytes between two buffers.
+ *
+ * Runs separated by at most gap equal bytes are merged into one, so small
+ * unchanged islands inside a larger edit do not split it into many lines.
+ *
+ * @param a Original buffer.
+ * @param b Modified buffer. Only the common length of both buffers is compared.
+ * @param gap Maximum number of equal bytes between two runs that are merged.
+ * @return Differing runs in ascending order.
+ */
+auto diff::find_runs(std::span<const std::uint8_t> a, std::span<const std::uint8_t> b, std::size_t gap) -> std::vector<run>
+{
+    auto const size = std::min(a.size(), b.size());
+    auto const x = a.first(size);
+    auto const y = b.first(size);
+
+    auto result = std::vector<run> {};
+
+    for (auto start = next_mismatch(x, y, 0); start < size;)
+    {
+        auto const end = next_match(x, y, start);
+        auto const next = next_mismatch(x, y, end);
+
+        if (!result.empty() && start - (result.back().offset + result.back().size) <= gap)
+            result.back().size = end - result.back().offset;
+        else
+            result.push_back({ .offset = start, .size = end - start });
+
+        start = next;
+    }
+
+    return result;
+}
+
+/**
+ * Split runs at section boundaries, so each run maps to one contiguous RVA range.
+ *
+ * @param image On-disk image the runs are offsets into.
+ * @param runs Runs to split.
+ * @return Runs that do not cross the start or end of any section's raw data.
+ */
+auto diff::split_runs(const pe::image& image, std::span<const run> runs) -> std::vector<run>
+{
+    auto bounds = std::vector<std::size_t> {};
+
+    for (auto&& section: image.sections())
+    {
+        bounds.push_back(section.raw_offset);
+        bounds.push_back(std::size_t { section.raw_offset } + section.raw_size);
+    }
+
+    std::ranges::sort(bounds);
+    bounds.erase(std::ranges::unique(bounds).begin(), bounds.end());
+
+    auto result = std::vector<run> {};
+
+    for (auto [offset, size]: runs)
+    {
+        auto const end = offset + size;
+        auto it = std::ranges::upper_bound(bounds, offset);
+
+        for (; it != bounds.end() && *it < end; ++it)
+        {
+            result.push_back({ .offset = offset, .size = *it - offset });
+            offset = *it;
+        }
+
+        result.push_back({ .offset = offset, .size = end - offset });
+    }
+
+    return result;
+}
+
+/**
+ * Format a differing run as a patch line with 'on' and 'off' bytes.
+ *
+ * @param image On-disk original image, used to convert offsets to RVAs.
+ * @param target Module name written as the patch target.
+ * @param run Differing run to format.
+ * @param original Original file contents.
+ * @param modified Modified file contents.
+ * @param type Whether to write 'F+' file offsets or RVAs.
+ * @return The patch line, or nothing if the offset has no RVA.
+ */
+auto diff::format_line(const pe::image& image, std::string_view target, const run& run,
+    std::span<const std::uint8_t> original, std::span<const std::uint8_t> modified, offsets type) -> std::optional<std::string>
+{
+    auto result = target.find(' ') != std::string_view::npos ?
+        std::format("\"{}\" ", target): std::format("{} ", target);
+
+    if (type == offsets::file)
+        result += std::format("F+{:X}", run.offset);
+    else if (auto const rva = image.file2rva(run.offset))
+        result += std::format("{:X}", *rva);
+    else
+        return std::nullopt;
+
+    auto const append = [&] (std::span<const std::uint8_t> bytes)
+    {
+        auto constexpr digits = std::string_view { "0123456789ABCDEF" };
+
+        result += ' ';
+
+        for (auto&& byte: bytes.subspan(run.offset, run.size))
+        {
+            result += digits[byte >> 4];
+            result += digits[byte & 0xF];
+        }
+    };
+
+    result.reserve(result.size() + run.size * 4 + 2);
+    append(modified);
+    append(original);
+
+    return result;
+}
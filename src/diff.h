@@ -0,0 +1,28 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include "pe.h"
+
+namespace mempatcher::diff
+{
+    enum class offsets { file, rva };
+
+    struct run
+    {
+        std::size_t offset;
+        std::size_t size;
+    };
+
+    [[nodiscard]] auto next_mismatch(std::span<const std::uint8_t> a, std::span<const std::uint8_t> b, std::size_t from) -> std::size_t;
+    [[nodiscard]] auto next_match(std::span<const std::uint8_t> a, std::span<const std::uint8_t> b, std::size_t from) -> std::size_t;
+    [[nodiscard]] auto find_runs(std::span<const std::uint8_t> a, std::span<const std::uint8_t> b, std::size_t gap = 0) -> std::vector<run>;
+    [[nodiscard]] auto split_runs(const pe::image& image, std::span<const run> runs) -> std::vector<run>;
+    [[nodiscard]] auto format_line(const pe::image& image, std::string_view target, const run& run,
+        std::span<const std::uint8_t> original, std::span<const std::uint8_t> modified, offsets type) -> std::optional<std::string>;
+}
@@ -0,0 +1,169 @@
+#include <bit>
+#include <cctype>
+#include <algorithm>
+
+#include "glob.h"
+
+using namespace mempatcher;
+using namespace mempatcher::glob;
+
+namespace mempatcher::glob::detail
+{
+    auto test(const std::vector<std::uint64_t>& set, std::size_t index) -> bool
+        { return (set[index / 64] >> (index % 64)) & 1; }
+
+    auto set(std::vector<std::uint64_t>& set, std::size_t index) -> void
+        { set[index / 64] |= std::uint64_t { 1 } << (index % 64); }
+
+    /**
+     * Module names are case-insensitive on Windows, as are the loader and GetModuleHandle.
+     */
+    auto lowercase(std::string_view name) -> std::string
+    {
+        auto result = std::string { name };
+
+        for (auto& c: result)
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+        return result;
+    }
+}
+
+/**
+ * Check whether a target name contains wildcard characters.
+ *
+ * @param target Target module name.
+ * @return True if the name is a pattern, false if it is an exact name.
+ */
+auto glob::is_pattern(std::string_view target) -> bool
+    { return target.find_first_of("*?") != std::string_view::npos; }
+
+/**
+ * Compile a list of targets into a matcher. Matching ignores case.
+ *
+ * @param targets Target module names or patterns. Match results are indices into this list.
+ */
+matcher::matcher(const std::vector<std::string>& targets): count { targets.size() }
+{
+    for (auto i = std::size_t {}; i < targets.size(); ++i)
+    {
+        auto const target = detail::lowercase(targets[i]);
+
+        if (!is_pattern(target))
+        {
+            exact[target].push_back(i);
+            continue;
+        }
+
+        for (auto&& ch: target)
+        {
+            if (ch == '*')
+            {
+                // consecutive stars are equivalent to a single one
+                if (!states.empty() && states.back().type == token::star && states.back().target == i)
+                    continue;
+
+                stars.push_back(states.size());
+                states.push_back({ .type = token::star, .ch = ch, .target = i });
+            }
+            else if (ch == '?')
+                states.push_back({ .type = token::any, .ch = ch, .target = i });
+            else
+                states.push_back({ .type = token::literal, .ch = ch, .target = i });
+        }
+
+        states.push_back({ .type = token::accept, .ch = '\0', .target = i });
+    }
+
+    if (states.empty())
+        return;
+
+    initial.resize((states.size() + 63) / 64);
+
+    // every pattern starts at the state following the previous accept state
+    for (auto i = std::size_t {}; i < states.size(); ++i)
+        if (i == 0 || states[i - 1].type == token::accept)
+            detail::set(initial, i);
+
+    close(initial);
+}
+
+/**
+ * Add states reachable by skipping a star to a state set.
+ *
+ * @param set State set to extend.
+ */
+auto matcher::close(std::vector<std::uint64_t>& set) const -> void
+{
+    // stars are in ascending order, so chains of skips propagate forwards
+    for (auto&& star: stars)
+        if (detail::test(set, star))
+            detail::set(set, star + 1);
+}
+
+/**
+ * Find every target that matches a module name.
+ *
+ * @param name Module name to match.
+ * @return Indices of the matching targets, exact matches first.
+ */
+auto matcher::match(std::string_view name) const -> std::vector<std::size_t>
+{
+    auto result = std::vector<std::size_t> {};
+    auto const lower = detail::lowercase(name);
+
+    if (auto const it = exact.find(lower); it != exact.end())
+        result = it->second;
+
+    if (states.empty())
+        return result;
+
+    auto current = initial;
+    auto next = std::vector<std::uint64_t>(current.size());
+
+    for (auto&& ch: lower)
+    {
+        std::ranges::fill(next, 0);
+
+        for (auto word = std::size_t {}; word < current.size(); ++word)
+        {
+            for (auto bits = current[word]; bits != 0; bits &= bits - 1)
+            {
+                auto const index = word * 64 + std::countr_zero(bits);
+                auto const& state = states[index];
+
+                if (state.type == token::star)
+                    detail::set(next, index);
+                else if (state.type == token::any || (state.type == token::literal && state.ch == ch))
+                    detail::set(next, index + 1);
+            }
+        }
+
+        close(next);
+        std::swap(current, next);
+
+        if (std::ranges::all_of(current, [] (auto bits) { return bits == 0; }))
+            return result;
+    }
+
+    for (auto word = std::size_t {}; word < current.size(); ++word)
+    {
+        for (auto bits = current[word]; bits != 0; bits &= bits - 1)
+        {
+            auto const& state = states[word * 64 + std::countr_zero(bits)];
+
+            if (state.type == token::accept)
+                result.push_back(state.target);
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Get the number of targets the matcher was compiled from.
+ *
+ * @return Number of targets.
+ */
+auto matcher::size() const -> std::size_t
+    { return count; }
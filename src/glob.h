@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+namespace mempatcher::glob
+{
+    [[nodiscard]] auto is_pattern(std::string_view target) -> bool;
+
+    /**
+     * Matches module names against a fixed set of targets in a single pass.
+     *
+     * Exact names are looked up in a hash map, while patterns containing '*'
+     * or '?' are compiled into one combined automaton that is stepped once
+     * per character of the module name. Like the loader, it ignores case.
+     */
+    class matcher
+    {
+    public:
+        matcher() = default;
+        explicit matcher(const std::vector<std::string>& targets);
+
+        [[nodiscard]] auto match(std::string_view name) const -> std::vector<std::size_t>;
+        [[nodiscard]] auto size() const -> std::size_t;
+
+    private:
+        enum class token: std::uint8_t { literal, any, star, accept };
+
+        struct state
+        {
+            token type;
+            char ch;
+            std::size_t target;
+        };
+
+        std::size_t count {};
+        std::unordered_map<std::string, std::vector<std::size_t>> exact;
+        std::vector<state> states;
+        std::vector<std::size_t> stars;
+        std::vector<std::uint64_t> initial;
+
+        auto close(std::vector<std::uint64_t>& set) const -> void;
+    };
+}
@@ -1,8 +1,19 @@
+#include <mutex>
+#include <memory>
+#include <utility>
 #include <ranges>
+#include <iterator>
 
+#include "log.h"
+#include "glob.h"
 #include "util.h"
+#include "cache.h"
 #include "hooks.h"
+#include "plan.h"
 #include "patch.h"
+#include "retry.h"
+#include "mapping.h"
+#include "process.h"
 
 using namespace mempatcher;
 using namespace mempatcher::hooks;
@@ -11,16 +22,104 @@ namespace mempatcher::hooks::detail
 {
     auto cookie = PVOID {};
     auto module = HMODULE {};
-    auto patches = patch_list {};
+    auto targets = glob::matcher {};
+    auto names = std::vector<std::string> {};
+    auto ids = std::unordered_map<std::string, std::size_t> {};
+
+    // patches stay resident while waiting for their modules, so they are counted with their contents
+    auto memory = alloc::counting_resource {};
+    auto pending = std::pmr::vector<patch_list> { &memory };
+    auto remaining = std::size_t {};
+    auto sequence = std::size_t {};
+    auto plans = std::vector<std::optional<plan::module_plan>> {};
+    auto applied = std::vector<patch::journal> {};
+    auto backend = memory::process {};
+    auto const cache_path = std::filesystem::path { "mempatcher.cache" };
+
+    // loaded by the first apply or by listen, not during CRT init where it would run even
+    // without patches, and never by the loader callback
+    auto resolved = std::optional<cache::store> {};
+
+    // loaded modules, taken once for every apply before listen instead of once per call
+    auto modules = std::optional<std::vector<std::pair<std::string, std::uint8_t*>>> {};
 
     decltype(LdrUnregisterDllNotification)* unregister_fn {};
+
+    /**
+     * Patches for a loaded module whose expected bytes did not match yet,
+     * e.g. because the module unpacks its code after being mapped.
+     */
+    struct retry_job
+    {
+        std::uint8_t* base;
+        std::vector<std::size_t> ids;
+        std::pmr::vector<patch_list> groups;
+        std::uint64_t started;
+        std::uint32_t attempts;
+        bool cancelled;
+    };
+
+    auto constexpr retry_tick = std::chrono::milliseconds { 10 };
+    auto constexpr retry_max_backoff = std::uint64_t { 64 };
+
+    // guards everything below as well as pending and remaining once retries are running.
+    // never held while calling into the loader, which would deadlock against the loader lock
+    auto lock = std::mutex {};
+    auto wheel = retry::timer_wheel {};
+    auto jobs = std::vector<std::unique_ptr<retry_job>> {};
+    auto free_jobs = std::vector<std::size_t> {};
+    auto retrying = false;
+}
+
+/**
+ * Persist newly resolved addresses for the next launch.
+ * Never called from the loader callback, which runs before the module's entry point.
+ */
+auto save_cache() -> void
+{
+    if (detail::resolved && detail::resolved->dirty())
+        detail::resolved->save(detail::cache_path);
+}
+
+/**
+ * Get the address cache, reading it from disk the first time.
+ *
+ * @return Address cache shared by every transaction of the loader thread.
+ */
+auto load_cache() -> cache::store&
+{
+    if (!detail::resolved)
+        detail::resolved = cache::store::load(detail::cache_path);
+
+    return *detail::resolved;
 }
 
 /**
- * Unload module from process.
+ * Save the address cache once DllMain has returned, keeping the module loaded until it is written.
+ */
+auto WINAPI save_cache_async(PVOID) -> DWORD
+{
+    {
+        auto const guard = std::scoped_lock { detail::lock };
+        save_cache();
+    }
+
+    FreeLibraryAndExitThread(detail::module, EXIT_SUCCESS);
+}
+
+/**
+ * Unload module from process, saving the address cache on the way out.
  */
 auto WINAPI unload(PVOID = nullptr) -> DWORD
 {
+    {
+        auto const guard = std::scoped_lock { detail::lock };
+        save_cache();
+    }
+
+    LOG_INFO("All patches applied, unloading from process...");
+    log::flush();
+
     FreeLibraryAndExitThread(detail::module, EXIT_SUCCESS);
 }
 
@@ -37,12 +136,206 @@ auto WINAPI unregister_and_unload(PVOID) -> DWORD
     return EXIT_FAILURE;
 }
 
+/**
+ * Hand the patches of a retry job back to the pending list and free its slot.
+ * Must be called with the lock held.
+ *
+ * @param id Slot of the job.
+ */
+auto release_job(std::size_t id) -> void
+{
+    auto const job = std::move(detail::jobs[id]);
+
+    for (auto i = std::size_t {}; i < job->ids.size(); ++i)
+        std::ranges::move(job->groups[i], std::back_inserter(detail::pending[job->ids[i]]));
+
+    detail::free_jobs.push_back(id);
+}
+
+/**
+ * Make one attempt at applying the patches of a retry job.
+ *
+ * The module is pinned for the duration of the attempt, so it cannot be
+ * unloaded while its memory is being compared and written.
+ *
+ * @param id Slot of the job.
+ */
+auto attempt_job(std::size_t id) -> void
+{
+    auto const job = [&]
+    {
+        auto const guard = std::scoped_lock { detail::lock };
+        return detail::jobs[id].get();
+    }();
+
+    auto handle = HMODULE {};
+    auto const pinned = GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
+        reinterpret_cast<LPCWSTR>(job->base), &handle) && reinterpret_cast<std::uint8_t*>(handle) == job->base;
+
+    auto const cancelled = [&]
+    {
+        auto const guard = std::scoped_lock { detail::lock };
+        return !pinned || job->cancelled;
+    }();
+
+    // the address cache belongs to the loader thread, so retries always resolve
+    auto transaction = patch::transaction { detail::backend };
+
+    for (auto&& group: job->groups)
+        for (auto&& patch: group)
+            transaction.add(job->base, patch);
+
+    auto const applied = !cancelled && transaction.prepare() && transaction.commit();
+    auto const failed = transaction.failed();
+
+    if (pinned)
+        FreeLibrary(handle);
+
+    auto const guard = std::scoped_lock { detail::lock };
+
+    if (applied)
+    {
+        detail::remaining -= transaction.size();
+        detail::jobs[id].reset();
+        detail::free_jobs.push_back(id);
+        return;
+    }
+
+    auto const elapsed = detail::retry_tick * static_cast<std::int64_t>(detail::wheel.now() - job->started);
+
+    // only the patch that failed decides whether to keep going, unmarked ones give up at once
+    if (job->cancelled || !failed || !failed->retry || elapsed >= *failed->retry)
+        return release_job(id);
+
+    auto const backoff = std::uint64_t { 1 } << std::min(job->attempts++, 6u);
+    detail::wheel.schedule(id, std::min(backoff, detail::retry_max_backoff));
+}
+
+/**
+ * Service the retry wheel until it runs empty, then unload if nothing else is pending.
+ */
+auto WINAPI service_retries(PVOID) -> DWORD
+{
+    auto expired = std::vector<std::size_t> {};
+
+    while (true)
+    {
+        Sleep(static_cast<DWORD>(detail::retry_tick.count()));
+
+        {
+            auto const guard = std::scoped_lock { detail::lock };
+            detail::wheel.advance(expired);
+
+            if (expired.empty() && detail::wheel.empty())
+            {
+                detail::retrying = false;
+
+                if (detail::remaining != 0)
+                    return EXIT_SUCCESS;
+
+                break;
+            }
+        }
+
+        for (auto&& id: expired)
+            attempt_job(id);
+
+        expired.clear();
+    }
+
+    return unregister_and_unload(nullptr);
+}
+
+/**
+ * Move the pending patches of a module into a retry job and start servicing retries.
+ * Must be called with the lock held.
+ *
+ * @param base Base address of the module.
+ * @param ids Targets that matched the module.
+ */
+auto schedule_retry(std::uint8_t* base, const std::vector<std::size_t>& ids) -> void
+{
+    auto job = std::make_unique<detail::retry_job>(detail::retry_job {
+        .base = base,
+        .ids = ids,
+        .groups = std::pmr::vector<patch_list> { &detail::memory },
+        .started = detail::wheel.now(),
+        .attempts = 0,
+        .cancelled = false
+    });
+
+    for (auto&& id: ids)
+        job->groups.push_back(std::exchange(detail::pending[id], patch_list { &detail::memory }));
+
+    auto id = detail::jobs.size();
+
+    if (detail::free_jobs.empty())
+        detail::jobs.push_back(std::move(job));
+    else
+    {
+        id = detail::free_jobs.back();
+        detail::free_jobs.pop_back();
+        detail::jobs[id] = std::move(job);
+    }
+
+    detail::wheel.schedule(id, 1);
+
+    if (detail::retrying)
+        return;
+
+    auto const thread = CreateThread(nullptr, 0, service_retries, nullptr, 0, nullptr);
+
+    if (thread)
+    {
+        detail::retrying = true;
+        CloseHandle(thread);
+
+        return;
+    }
+
+    // nothing would ever service the job, so give the patches back to wait for the next load.
+    // no thread was running either, so this job is the only timer on the wheel
+    LOG_WARN("Failed to start retry thread for patches at {}", static_cast<const void*>(base));
+
+    detail::wheel = retry::timer_wheel {};
+    release_job(id);
+}
+
+/**
+ * Check whether a loaded module was mapped from the file a plan was made from.
+ *
+ * Only compares the paths, since the file cannot be opened under the loader lock.
+ *
+ * @param plan Plan to check.
+ * @param loaded Full path of the loaded module.
+ * @return True if the paths name the same file, false otherwise.
+ */
+auto planned_from(const plan::module_plan& plan, std::wstring_view loaded) -> bool
+{
+    auto const path = plan.path.wstring();
+
+    return !path.empty() && CompareStringOrdinal(path.data(), static_cast<int>(path.size()),
+        loaded.data(), static_cast<int>(loaded.size()), TRUE) == CSTR_EQUAL;
+}
+
 /**
  * Handle newly loaded DLLs and apply patches.
  */
 auto CALLBACK dll_notification(ULONG reason, PCLDR_DLL_NOTIFICATION_DATA data, PVOID) -> void
 {
-    if (detail::patches.empty() || reason != LDR_DLL_NOTIFICATION_REASON_LOADED)
+    auto const guard = std::scoped_lock { detail::lock };
+
+    // retries for an unloaded module are dropped on their next attempt
+    if (reason == LDR_DLL_NOTIFICATION_REASON_UNLOADED)
+    {
+        for (auto&& job: detail::jobs)
+            if (job && job->base == data->Unloaded.DllBase)
+                job->cancelled = true;
+
+        return;
+    }
+
+    if (detail::remaining == 0 || reason != LDR_DLL_NOTIFICATION_REASON_LOADED)
         return;
 
     auto const address = static_cast<std::uint8_t*>(data->Loaded.DllBase);
@@ -51,101 +344,319 @@ auto CALLBACK dll_notification(ULONG reason, PCLDR_DLL_NOTIFICATION_DATA data, P
         data->Loaded.BaseDllName->Length / sizeof(wchar_t)
     });
 
-    auto const has_patches = std::ranges::any_of(detail::patches, [&] (auto&& patch)
-        { return patch.target == module; });
+    auto const path = std::wstring_view {
+        data->Loaded.FullDllName->Buffer,
+        data->Loaded.FullDllName->Length / sizeof(wchar_t)
+    };
+
+    auto const matched = detail::targets.match(module);
 
-    if (!has_patches)
+    if (matched.empty())
         return;
 
-    auto applied = std::vector<patch_list::size_type> {};
+    // this runs for every load, so the usage is only logged and never kept
+    auto phase = alloc::phase { detail::memory, module };
+    phase.discard();
 
-    for (auto i = 0; i < detail::patches.size(); ++i)
+    // apply everything for this module at once, or nothing at all. listen loaded the cache
+    auto transaction = patch::transaction { detail::backend, &*detail::resolved };
+    auto const build = pe::image::from_module(address).build();
+
+    for (auto&& id: matched)
     {
-        if (detail::patches[i].target != module)
-            continue;
+        auto const& plan = detail::plans[id];
+        auto const& patches = detail::pending[id];
 
-        if (!patch::apply(address, detail::patches[i]))
-            break;
+        // a plan only holds for the exact file it was made from, and another
+        // copy of the same build elsewhere on the search path may be patched differently
+        auto const planned = plan && plan->build == build && planned_from(*plan, path)
+            && plan->steps.size() == patches.size();
 
-        applied.emplace_back(i);
+        for (auto i = std::size_t {}; i < patches.size(); ++i)
+        {
+            if (planned && plan->steps[i])
+                transaction.add(address, patches[i], *plan->steps[i]);
+            else
+                transaction.add(address, patches[i]);
+        }
     }
 
-    for (auto&& i: applied | std::views::reverse)
-        detail::patches.erase(detail::patches.begin() + i);
+    LOG_DEBUG("Loaded target file '{}' at address {}", module, static_cast<const void*>(address));
+
+    if (!transaction.prepare() || !transaction.commit())
+    {
+        auto const failed = transaction.failed();
+
+        if (failed)
+            LOG_WARN("Failed to apply patch from '{}':{} at {}", failed->file, failed->line, failed->target_name());
+
+        // code that is unpacked after mapping may match later
+        if (failed && failed->retry)
+            schedule_retry(address, matched);
 
-    if (!detail::patches.empty())
+        return;
+    }
+
+    LOG_INFO("Applied {} patches to '{}'", transaction.size(), module);
+
+    // release the storage as well, it would otherwise stay resident until unload
+    for (auto&& id: matched)
+    {
+        detail::remaining -= detail::pending[id].size();
+        detail::pending[id] = patch_list { &detail::memory };
+        detail::plans[id].reset();
+    }
+
+    // records stay buffered, the loader lock is held here so the file is written on unload
+    log_usage(module, phase);
+
+    // with retries still running, the retry thread unloads once it is done
+    if (detail::remaining != 0 || detail::retrying)
         return;
 
     CreateThread(nullptr, 0, unregister_and_unload, nullptr, 0, nullptr);
 }
 
 /**
- * Attempts to apply patches if the target module is already loaded.
+ * Get the resource that patches waiting for their module are allocated from,
+ * including their names and bytes.
+ *
+ * @return Resource shared by the parser, install and the loader callback.
+ */
+auto hooks::memory() -> alloc::counting_resource&
+    { return detail::memory; }
+
+/**
+ * Log what a phase has allocated so far and how much is still allocated overall.
+ *
+ * @param name Name to log the usage under.
+ * @param phase Phase recording the usage.
+ */
+auto hooks::log_usage([[maybe_unused]] std::string_view name, [[maybe_unused]] const alloc::phase& phase) -> void
+{
+    [[maybe_unused]] auto const used = phase.used();
+
+    LOG_DEBUG("Memory used by '{}': {} allocations, {} bytes, {} bytes peak, {} bytes resident",
+        name, used.count, used.bytes, used.peak, detail::memory.live());
+}
+
+/**
+ * Find the base address of a target if it is already loaded.
+ *
+ * @param target Target module name or pattern.
+ * @param modules Modules currently loaded in the process.
+ * @return Base address if loaded, otherwise nothing.
+ */
+auto find_loaded(const std::string& target, const std::vector<std::pair<std::string, std::uint8_t*>>& modules)
+    -> std::optional<std::uint8_t*>
+{
+    if (target == "-")
+        return nullptr;
+
+    if (target == "<host>")
+        return reinterpret_cast<std::uint8_t*>(GetModuleHandle(nullptr));
+
+    if (!glob::is_pattern(target))
+    {
+        if (auto const handle = GetModuleHandleA(target.c_str()))
+            return reinterpret_cast<std::uint8_t*>(handle);
+
+        return std::nullopt;
+    }
+
+    auto const pattern = glob::matcher { std::vector { target } };
+
+    for (auto&& [name, base]: modules)
+        if (!pattern.match(name).empty())
+            return base;
+
+    return std::nullopt;
+}
+
+/**
+ * Apply patches for every module that is already loaded and keep the rest for later.
+ *
+ * Can be called repeatedly as patches are parsed, before listen. Patches for each
+ * loaded module in one call are applied as a single transaction. If any of them
+ * fail, everything from this call is rolled back.
+ *
+ * @param patches Patches to apply.
+ * @return True if every patch for a loaded module was applied, false otherwise.
  */
-auto apply_if_loaded(parser::patch& patch) -> std::optional<bool>
+auto hooks::apply(patch_list&& patches) -> bool
 {
-    if (patch.target == "-")
-        return patch::apply(nullptr, patch);
+    // group patches by target so each one is only looked up once
+    auto names = std::vector<std::string> {};
+    auto groups = std::pmr::vector<patch_list> { &detail::memory };
+    auto ids = std::pmr::unordered_map<std::pmr::string, std::size_t> { &detail::memory };
 
-    if (patch.target == "<host>")
+    for (auto&& patch: patches)
     {
-        auto const address = GetModuleHandle(nullptr);
-        return patch::apply(reinterpret_cast<std::uint8_t*>(address), patch);
+        // numbered across calls, so a module matched by several targets is still patched in file order
+        patch.order = detail::sequence++;
+
+        auto const [it, inserted] = ids.try_emplace(patch.target, names.size());
+
+        if (inserted)
+        {
+            names.emplace_back(patch.target);
+            groups.emplace_back();
+        }
+
+        groups[it->second].push_back(std::move(patch));
     }
 
-    if (auto const handle = GetModuleHandleA(patch.target.c_str()))
+    // apply patches for any libraries that are already loaded. nothing else can load
+    // while DllMain runs, so one snapshot serves every call until listen
+    if (!detail::modules && std::ranges::any_of(names, glob::is_pattern))
+        detail::modules = util::get_modules();
+
+    auto const none = decltype(detail::modules)::value_type {};
+    auto const& modules = detail::modules ? *detail::modules: none;
+
+    auto bases = std::vector<std::uint8_t*> {};
+    auto transactions = std::vector<patch::transaction> {};
+    auto loaded = std::vector<bool>(names.size());
+
+    for (auto id = std::size_t {}; id < names.size(); ++id)
     {
-        auto static seen = std::vector<decltype(patch.target)> {};
+        auto const address = find_loaded(names[id], modules);
+
+        if (!address.has_value())
+            continue; // not loaded yet
 
-        if (std::ranges::find(seen, patch.target) == seen.end())
+        // group by module so each one is patched in a single transaction
+        auto const index = static_cast<std::size_t>
+            (std::ranges::find(bases, *address) - bases.begin());
+
+        if (index == bases.size())
         {
-            seen.push_back(patch.target);
+            bases.push_back(*address);
+            transactions.emplace_back(detail::backend, &load_cache());
         }
 
-        return patch::apply(reinterpret_cast<std::uint8_t*>(handle), patch);
+        for (auto&& patch: groups[id])
+            transactions[index].add(*address, patch);
+
+        loaded[id] = true;
     }
 
-    return std::nullopt;
+    for (auto i = std::size_t {}; i < transactions.size(); ++i)
+    {
+        if (transactions[i].prepare() && transactions[i].commit())
+        {
+            LOG_DEBUG("Applied {} patches at {}", transactions[i].size(), static_cast<const void*>(bases[i]));
+            continue;
+        }
+
+        if (auto const failed = transactions[i].failed())
+            LOG_ERROR("Failed to apply patch from '{}':{} at {}", failed->file, failed->line, failed->target_name());
+
+        // undo modules that were already patched, then fail
+        for (auto j = i; j-- > 0;)
+            transactions[j].rollback();
+
+        return false;
+    }
+
+    // only the journals are kept, the applied patches are released with this batch
+    for (auto&& transaction: transactions)
+        detail::applied.push_back(transaction.changes());
+
+    for (auto id = std::size_t {}; id < names.size(); ++id)
+    {
+        if (loaded[id])
+            continue;
+
+        auto const [it, inserted] = detail::ids.try_emplace(names[id], detail::names.size());
+
+        if (inserted)
+        {
+            detail::names.push_back(names[id]);
+            detail::pending.emplace_back();
+        }
+
+        detail::remaining += groups[id].size();
+        std::ranges::move(groups[id], std::back_inserter(detail::pending[it->second]));
+    }
+
+    return true;
 }
 
 /**
- * Installs notifications for loader events.
- *
- * @param module Handle to this module.
- * @param patches List of patches to apply.
- * @return True if the module should remain loaded, false otherwise.
+ * Undo every patch applied so far with apply, newest first.
  */
-auto hooks::install(HMODULE module, patch_list&& patches) -> bool
+auto hooks::revert() -> void
 {
-    detail::module = module;
-    detail::patches = std::move(patches);
+    for (auto&& changes: detail::applied | std::views::reverse)
+        patch::revert(detail::backend, changes);
 
-    // apply patches for any libraries that are already loaded
-    auto applied = std::vector<patch_list::size_type> {};
+    detail::applied.clear();
+}
 
-    for (auto i = 0; i < detail::patches.size(); ++i)
+/**
+ * Plan the pending patches of every target that can be found on disk, so the
+ * loader callback only has to check the build and write.
+ *
+ * Pattern targets cannot be looked up by name and are resolved on load as usual.
+ */
+auto prepare_plans() -> void
+{
+    detail::plans.resize(detail::names.size());
+
+    for (auto id = std::size_t {}; id < detail::names.size(); ++id)
     {
-        auto const result = apply_if_loaded(detail::patches[i]);
+        auto const& name = detail::names[id];
 
-        if (!result.has_value())
-            continue; // not loaded yet
+        if (detail::pending[id].empty() || glob::is_pattern(name) || name == "<host>" || name == "-")
+            continue;
+
+        auto const path = util::find_library(name);
 
-        if (!*result)
-            return false; // failed to apply
+        if (!path)
+            continue;
+
+        auto const mapping = file_mapping::open(*path);
+
+        if (!mapping)
+            continue;
 
-        applied.emplace_back(i); // applied
+        auto const bytes = mapping->bytes();
+        auto const file = pe::image { bytes.data(), bytes.size(), pe::layout::file };
+
+        if (!file.valid())
+            continue;
+
+        detail::plans[id] = plan::prepare(file, detail::pending[id]);
+        detail::plans[id]->path = *path;
     }
+}
 
-    for (auto&& i: applied | std::views::reverse)
-        detail::patches.erase(detail::patches.begin() + i);
+/**
+ * Listen for loader events to apply the remaining patches, or unload if there are none.
+ *
+ * @param module Handle to this module.
+ * @return True if the module should remain loaded, false otherwise.
+ */
+auto hooks::listen(HMODULE module) -> bool
+{
+    detail::module = module;
+    detail::modules.reset();
 
     // if everything was applied, unload now
-    if (detail::patches.empty())
+    if (detail::remaining == 0)
     {
         CreateThread(nullptr, 0, unload, nullptr, 0, nullptr);
         return true;
     }
 
+    detail::targets = glob::matcher { detail::names };
+
+    prepare_plans();
+
+    // read now, so the loader callback never touches the disk
+    load_cache();
+
     // catch future libraries
     auto const imports = util::resolve_dll_imports("ntdll.dll",
         { "LdrRegisterDllNotification", "LdrUnregisterDllNotification" });
@@ -163,5 +674,42 @@ auto hooks::install(HMODULE module, patch_list&& patches) -> bool
 
     auto const result = register_fn(0, dll_notification, nullptr, &detail::cookie);
 
-    return NT_SUCCESS(result);
-}
\ No newline at end of file
+    if (!NT_SUCCESS(result))
+        return false;
+
+    // saved once in case the remaining modules never load, and again on unload. only started
+    // once the module is sure to stay loaded, and pinned so it cannot unload in the meantime
+    auto pinned = HMODULE {};
+
+    if (GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, reinterpret_cast<LPCWSTR>(&save_cache_async), &pinned))
+    {
+        if (auto const thread = CreateThread(nullptr, 0, save_cache_async, nullptr, 0, nullptr))
+            CloseHandle(thread);
+        else
+            FreeLibrary(pinned);
+    }
+
+    return true;
+}
+
+/**
+ * Installs notifications for loader events.
+ *
+ * @param module Handle to this module.
+ * @param patches List of patches to apply.
+ * @return True if the module should remain loaded, false otherwise.
+ */
+auto hooks::install(HMODULE module, patch_list&& patches) -> bool
+{
+    if (!apply(std::move(patches)))
+        return false;
+
+    if (listen(module))
+        return true;
+
+    // the module is about to be unloaded, so do not leave its patches behind
+    LOG_ERROR("Failed to listen for loader events, reverting applied patches...");
+    revert();
+
+    return false;
+}
@@ -1,10 +1,17 @@
 #pragma once
 
+#include "alloc.h"
 #include "parser.h"
 
 namespace mempatcher::hooks
 {
-    using patch_list = std::vector<parser::patch>;
+    using patch_list = parser::patch_list;
 
+    [[nodiscard]] auto memory() -> alloc::counting_resource&;
+    auto log_usage(std::string_view name, const alloc::phase& phase) -> void;
+
+    [[nodiscard]] auto apply(patch_list&& patches) -> bool;
+    auto revert() -> void;
+    [[nodiscard]] auto listen(HMODULE module) -> bool;
     auto install(HMODULE module, patch_list&& patches) -> bool;
 }
\ No newline at end of file
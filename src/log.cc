@@ -0,0 +1,111 @@
+#include <array>
+#include <mutex>
+#include <cstring>
+
+#include "log.h"
+
+using namespace mempatcher;
+
+#if MEMPATCHER_LOG_MINIMAL
+
+namespace mempatcher::log::detail
+{
+    auto constexpr path = L"mempatcher.log";
+
+    // records are collected here and written out with a single WriteFile per flush
+    auto storage = std::array<char, 64 * 1024> {};
+    auto used = std::size_t {};
+    auto created = false;
+    auto lock = std::mutex {};
+
+    /**
+     * Write the buffered records to the log file. Must be called with the lock held.
+     * The first write of a process replaces the file, later ones append to it.
+     */
+    auto write_out() -> void
+    {
+        if (used == 0)
+            return;
+
+        auto const file = CreateFileW(path, FILE_APPEND_DATA, FILE_SHARE_READ, nullptr,
+            created ? OPEN_ALWAYS: CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        if (file != INVALID_HANDLE_VALUE)
+        {
+            auto written = DWORD {};
+            WriteFile(file, storage.data(), static_cast<DWORD>(used), &written, nullptr);
+            CloseHandle(file);
+            created = true;
+        }
+
+        used = 0;
+    }
+}
+
+/**
+ * Nothing to set up, the log file is created by the first flush.
+ */
+auto log::init() -> void {}
+
+/**
+ * Append a formatted record with a timestamp to the log buffer, writing it out first if it is full.
+ *
+ * @param message Record without a trailing newline.
+ */
+auto log::append(std::string_view message) -> void
+{
+    auto time = SYSTEMTIME {};
+    GetLocalTime(&time);
+
+    auto prefix = std::array<char, 32> {};
+    auto const length = std::format_to_n(prefix.data(), prefix.size(), "[{:04}/{:02}/{:02} {:02}:{:02}:{:02}] ",
+        time.wYear, time.wMonth, time.wDay, time.wHour, time.wMinute, time.wSecond).size;
+
+    auto const head = std::string_view { prefix.data(), std::min<std::size_t>(length, prefix.size()) };
+    auto const size = head.size() + message.size() + 1;
+    auto const guard = std::scoped_lock { detail::lock };
+
+    if (detail::used + size > detail::storage.size())
+        detail::write_out();
+
+    if (size > detail::storage.size())
+        return;
+
+    auto const out = detail::storage.data() + detail::used;
+    std::memcpy(out, head.data(), head.size());
+    std::memcpy(out + head.size(), message.data(), message.size());
+    out[size - 1] = '\n';
+
+    detail::used += size;
+}
+
+auto log::flush() -> void
+{
+    auto const guard = std::scoped_lock { detail::lock };
+    detail::write_out();
+}
+
+#else
+
+/**
+ * Send log records to mempatcher.log, in the same format as the minimal backend.
+ */
+auto log::init() -> void
+{
+    try
+    {
+        spdlog::set_default_logger(spdlog::basic_logger_mt("mempatcher", "mempatcher.log", true));
+    }
+    catch (const spdlog::spdlog_ex&)
+    {
+        // keep logging to the console if the file cannot be opened
+    }
+
+    spdlog::set_pattern("[%Y/%m/%d %H:%M:%S] %v");
+    spdlog::set_level(spdlog::level::trace);
+}
+
+auto log::flush() -> void
+    { spdlog::default_logger()->flush(); }
+
+#endif
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <format>
+#include <utility>
+#include <algorithm>
+#include <string_view>
+
+/**
+ * Logging macros with the level fixed at compile time.
+ *
+ * Anything below MEMPATCHER_LOG_LEVEL expands to nothing, so its arguments
+ * are never evaluated or formatted. MEMPATCHER_LOG_MINIMAL selects the
+ * built-in buffered backend instead of spdlog.
+ */
+
+#define MEMPATCHER_LOG_LEVEL_TRACE 0
+#define MEMPATCHER_LOG_LEVEL_DEBUG 1
+#define MEMPATCHER_LOG_LEVEL_INFO  2
+#define MEMPATCHER_LOG_LEVEL_WARN  3
+#define MEMPATCHER_LOG_LEVEL_ERROR 4
+#define MEMPATCHER_LOG_LEVEL_OFF   5
+
+#ifndef MEMPATCHER_LOG_LEVEL
+    #define MEMPATCHER_LOG_LEVEL MEMPATCHER_LOG_LEVEL_INFO
+#endif
+
+namespace mempatcher::log
+{
+    auto init() -> void;
+    auto flush() -> void;
+
+#if MEMPATCHER_LOG_MINIMAL
+    auto append(std::string_view message) -> void;
+
+    /**
+     * Format a record on the stack and append it to the log buffer.
+     * Records longer than the stack buffer are truncated.
+     */
+    template <typename... Args>
+    auto write(std::format_string<Args...> format, Args&&... args) -> void
+    {
+        auto buffer = std::array<char, 512> {};
+        auto const result = std::format_to_n(buffer.data(), buffer.size(), format, std::forward<Args>(args)...);
+        append({ buffer.data(), std::min<std::size_t>(result.size, buffer.size()) });
+    }
+#endif
+}
+
+#if MEMPATCHER_LOG_MINIMAL
+    #define MEMPATCHER_LOG(severity, ...) ::mempatcher::log::write(__VA_ARGS__)
+#else
+    #define MEMPATCHER_LOG(severity, ...) ::spdlog::severity(__VA_ARGS__)
+#endif
+
+#if MEMPATCHER_LOG_LEVEL <= MEMPATCHER_LOG_LEVEL_TRACE
+    #define LOG_TRACE(...) MEMPATCHER_LOG(trace, __VA_ARGS__)
+#else
+    #define LOG_TRACE(...) ((void) 0)
+#endif
+
+#if MEMPATCHER_LOG_LEVEL <= MEMPATCHER_LOG_LEVEL_DEBUG
+    #define LOG_DEBUG(...) MEMPATCHER_LOG(debug, __VA_ARGS__)
+#else
+    #define LOG_DEBUG(...) ((void) 0)
+#endif
+
+#if MEMPATCHER_LOG_LEVEL <= MEMPATCHER_LOG_LEVEL_INFO
+    #define LOG_INFO(...) MEMPATCHER_LOG(info, __VA_ARGS__)
+#else
+    #define LOG_INFO(...) ((void) 0)
+#endif
+
+#if MEMPATCHER_LOG_LEVEL <= MEMPATCHER_LOG_LEVEL_WARN
+    #define LOG_WARN(...) MEMPATCHER_LOG(warn, __VA_ARGS__)
+#else
+    #define LOG_WARN(...) ((void) 0)
+#endif
+
+#if MEMPATCHER_LOG_LEVEL <= MEMPATCHER_LOG_LEVEL_ERROR
+    #define LOG_ERROR(...) MEMPATCHER_LOG(error, __VA_ARGS__)
+#else
+    #define LOG_ERROR(...) ((void) 0)
+#endif
@@ -1,11 +1,15 @@
 #include <ranges>
 
+#include "log.h"
 #include "util.h"
 #include "hooks.h"
 #include "buildinfo.h"
 
 using namespace mempatcher;
 
+// patches handed from the parser to the apply stage at a time in incremental mode
+auto constexpr incremental_chunk_size = std::size_t { 256 };
+
 /**
  * Find input patch files from the process command line.
  * Support both '--mempatch <file>' and '--mempatch=<file>' formats.
@@ -31,7 +35,7 @@ auto get_input_files(const std::vector<std::string>& argv)
 
         if (!exists(path))
         {
-            spdlog::warn("Patch file '{}' does not exist!", path.string());
+            LOG_WARN("Patch file '{}' does not exist!", path.string());
             continue;
         }
 
@@ -60,6 +64,40 @@ auto get_directory_files(const std::filesystem::path& path)
     return result;
 }
 
+/**
+ * Parse every patch file into a single list.
+ *
+ * @param files Patch files to read.
+ * @return List of patches, or nothing if any file failed to parse.
+ */
+auto read_patches(const std::vector<std::filesystem::path>& files) -> std::optional<hooks::patch_list>
+{
+    auto const phase = alloc::phase { hooks::memory(), "parse" };
+    auto result = hooks::patch_list { &hooks::memory() };
+
+    for (auto&& file: files)
+    {
+        LOG_DEBUG("Reading patch file '{}'", file.string());
+
+        auto patches = parser::read_file(file, &hooks::memory());
+
+        if (!patches)
+        {
+            LOG_ERROR("Failed to parse patch file '{}': {} (line {})", file.string(),
+                parser::make_error_code(patches.error().ec).message(), patches.error().line);
+
+            return std::nullopt;
+        }
+
+        std::ranges::move(*patches, std::back_inserter(result));
+    }
+
+    LOG_INFO("Parsed {} patches from {} files", result.size(), files.size());
+    hooks::log_usage("parse", phase);
+
+    return result;
+}
+
 /**
  * Get the base filename of the host module.
  *
@@ -92,6 +130,9 @@ auto DllMain(HINSTANCE module, DWORD reason, LPVOID) -> BOOL
 
     DisableThreadLibraryCalls(module);
 
+    log::init();
+    LOG_INFO("mempatcher {} ({}) loaded into '{}'", RC_FILEVERSION_STRING, GIT_COMMIT_HASH_SHORT, get_host_exe());
+
     auto const argv = util::get_argv();
     auto files = get_input_files(argv);
 
@@ -99,29 +140,64 @@ auto DllMain(HINSTANCE module, DWORD reason, LPVOID) -> BOOL
 
     if (files.empty())
     {
+        LOG_WARN("No patch files given, unloading from process...");
+        log::flush();
+
         return FALSE;
     }
 
-    auto patches = hooks::patch_list {};
-
-    for (auto&& file: files)
+    // apply patches chunk by chunk as they are read, so only unapplied patches are kept.
+    // parsing and applying take turns on this thread, a worker could not run under the loader lock
+    if (std::ranges::find(argv, "--mempatch-incremental") != argv.end())
     {
-        auto result = parser::read_file(file);
+        auto const phase = alloc::phase { hooks::memory(), "incremental" };
 
-        if (!result)
+        for (auto&& file: files)
         {
-            return FALSE;
+            auto const result = parser::read_file(file, [] (auto&& chunk)
+                { return hooks::apply(std::move(chunk)); }, incremental_chunk_size, &hooks::memory());
+
+            if (!result)
+            {
+                LOG_ERROR("Failed to read patch file '{}': {} (line {})", file.string(),
+                    parser::make_error_code(result.error().ec).message(), result.error().line);
+
+                hooks::revert();
+                log::flush();
+
+                return FALSE;
+            }
         }
 
-        for (auto&& patch: *result)
+        auto const listening = hooks::listen(module);
+
+        // nothing would ever apply the rest, so leave the process as it was
+        if (!listening)
         {
-            patches.push_back(std::move(patch));
+            LOG_ERROR("Failed to listen for loader events, reverting applied patches...");
+            hooks::revert();
         }
+
+        hooks::log_usage("incremental", phase);
+        log::flush();
+
+        return listening ? TRUE: FALSE;
     }
 
-    // set up hooks
-    if (!hooks::install(module, std::move(patches)))
+    auto patches = read_patches(files);
+
+    if (!patches)
+    {
+        log::flush();
         return FALSE;
+    }
+
+    // set up hooks
+    auto const install = alloc::phase { hooks::memory(), "install" };
+    auto const installed = hooks::install(module, std::move(*patches));
+
+    hooks::log_usage("install", install);
+    log::flush();
 
-    return TRUE;
+    return installed ? TRUE: FALSE;
 }
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include <utility>
+
+#include "mapping.h"
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+using namespace mempatcher;
+
+file_mapping::file_mapping(file_mapping&& other) noexcept:
+    view { std::exchange(other.view, nullptr) }, length { std::exchange(other.length, 0) } {}
+
+auto file_mapping::operator=(file_mapping&& other) noexcept -> file_mapping&
+{
+    std::swap(view, other.view);
+    std::swap(length, other.length);
+    return *this;
+}
+
+file_mapping::~file_mapping()
+{
+    if (!view)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(view);
+#else
+    munmap(const_cast<std::uint8_t*>(view), length);
+#endif
+}
+
+/**
+ * Map a file into memory for reading.
+ *
+ * @param path Path to the file.
+ * @return The mapping if successful, otherwise the system error. Empty files map to an empty view.
+ */
+auto file_mapping::open(const std::filesystem::path& path) -> std::expected<file_mapping, std::error_code>
+{
+    auto result = file_mapping {};
+
+#ifdef _WIN32
+    auto const last_error = [] ()
+        { return std::unexpected { std::error_code { static_cast<int>(GetLastError()), std::system_category() } }; };
+
+    auto const file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+        return last_error();
+
+    auto size = LARGE_INTEGER {};
+
+    if (!GetFileSizeEx(file, &size))
+    {
+        auto const error = last_error();
+        CloseHandle(file);
+        return error;
+    }
+
+    result.length = static_cast<std::size_t>(size.QuadPart);
+
+    if (result.length == 0)
+    {
+        CloseHandle(file);
+        return result;
+    }
+
+    auto const mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+
+    if (!mapping)
+        return last_error();
+
+    result.view = static_cast<const std::uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    CloseHandle(mapping);
+
+    if (!result.view)
+        return last_error();
+#else
+    auto const file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (file < 0)
+        return std::unexpected { std::error_code { errno, std::system_category() } };
+
+    struct stat info {};
+
+    if (fstat(file, &info) != 0)
+    {
+        auto const error = errno;
+        close(file);
+        return std::unexpected { std::error_code { error, std::system_category() } };
+    }
+
+    result.length = static_cast<std::size_t>(info.st_size);
+
+    if (result.length == 0)
+    {
+        close(file);
+        return result;
+    }
+
+    auto const view = mmap(nullptr, result.length, PROT_READ, MAP_PRIVATE, file, 0);
+    auto const error = errno;
+    close(file);
+
+    if (view == MAP_FAILED)
+        return std::unexpected { std::error_code { error, std::system_category() } };
+
+    // the whole file is compared front to back
+    madvise(view, result.length, MADV_SEQUENTIAL);
+    result.view = static_cast<const std::uint8_t*>(view);
+#endif
+
+    return result;
+}
+
+auto file_mapping::bytes() const -> std::span<const std::uint8_t>
+    { return { view, length }; }
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <span>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <system_error>
+
+namespace mempatcher
+{
+    /**
+     * Read-only memory mapping of a whole file.
+     *
+     * Pages are only read in as they are touched, so large images can be
+     * compared without copying them into memory first.
+     */
+    class file_mapping
+    {
+    public:
+        file_mapping(const file_mapping&) = delete;
+        file_mapping(file_mapping&& other) noexcept;
+        auto operator=(const file_mapping&) -> file_mapping& = delete;
+        auto operator=(file_mapping&& other) noexcept -> file_mapping&;
+        ~file_mapping();
+
+        [[nodiscard]] static auto open(const std::filesystem::path& path) -> std::expected<file_mapping, std::error_code>;
+
+        [[nodiscard]] auto bytes() const -> std::span<const std::uint8_t>;
+
+    private:
+        file_mapping() = default;
+
+        const std::uint8_t* view {};
+        std::size_t length {};
+    };
+}
@@ -0,0 +1,157 @@
+#include <cstring>
+#include <utility>
+
+#include "atomic.h"
+#include "memory.h"
+#include "checksum.h"
+
+using namespace mempatcher;
+using namespace mempatcher::memory;
+
+/**
+ * Create a backend over a byte buffer.
+ *
+ * @param memory Buffer to patch.
+ * @param page_size Simulated page size in bytes. Must be a power of two.
+ */
+buffer::buffer(std::span<std::uint8_t> memory, std::size_t page_size):
+    memory { memory }, page { page_size },
+    origin { reinterpret_cast<std::uintptr_t>(memory.data()) & ~(page_size - 1) }
+{
+    auto const end = reinterpret_cast<std::uintptr_t>(memory.data() + memory.size());
+    pages.resize((end - origin + page - 1) / page, read_only);
+}
+
+auto buffer::contains(const std::uint8_t* address, std::size_t size) const -> bool
+{
+    auto const begin = memory.data();
+    auto const end = memory.data() + memory.size();
+
+    return address >= begin && address <= end && static_cast<std::size_t>(end - address) >= size;
+}
+
+auto buffer::page_index(const std::uint8_t* address) const -> std::optional<std::size_t>
+{
+    auto const value = reinterpret_cast<std::uintptr_t>(address);
+
+    if (value < origin || (value - origin) / page >= pages.size())
+        return std::nullopt;
+
+    return (value - origin) / page;
+}
+
+/**
+ * Check whether a range is inside the buffer and every page covering it is unprotected.
+ *
+ * @param address Start of the range.
+ * @param size Size of the range in bytes.
+ * @return True if the whole range can be written, false otherwise.
+ */
+auto buffer::writable(const std::uint8_t* address, std::size_t size) const -> bool
+{
+    if (!contains(address, size))
+        return false;
+
+    if (size == 0)
+        return true;
+
+    for (auto i = *page_index(address); i <= *page_index(address + size - 1); ++i)
+        if (pages[i] != read_write)
+            return false;
+
+    return true;
+}
+
+/**
+ * Make unprotecting the page containing an address fail.
+ *
+ * @param address Address inside the page to lock.
+ */
+auto buffer::lock(const std::uint8_t* address) -> void
+{
+    if (auto const index = page_index(address))
+        pages[*index] = locked;
+}
+
+auto buffer::read(const std::uint8_t* address, std::span<std::uint8_t> out) -> bool
+{
+    if (!contains(address, out.size()))
+        return false;
+
+    std::memcpy(out.data(), address, out.size());
+    return true;
+}
+
+auto buffer::write(std::uint8_t* address, std::span<const std::uint8_t> data) -> bool
+{
+    if (!writable(address, data.size()))
+        return false;
+
+    atomic::write(address, data);
+    return true;
+}
+
+auto buffer::fill(std::uint8_t* address, std::uint8_t value, std::size_t count) -> bool
+{
+    if (!writable(address, count))
+        return false;
+
+    std::memset(address, value, count);
+    return true;
+}
+
+auto buffer::checksum(const std::uint8_t* address, std::size_t size) -> std::optional<std::uint32_t>
+{
+    if (!contains(address, size))
+        return std::nullopt;
+
+    return checksum::crc32c({ address, size });
+}
+
+auto buffer::unprotect(std::uint8_t* address) -> std::optional<std::uint32_t>
+{
+    auto const index = page_index(address);
+
+    if (!index || pages[*index] == locked)
+        return std::nullopt;
+
+    return std::exchange(pages[*index], read_write);
+}
+
+auto buffer::protect(std::uint8_t* address, std::uint32_t protection) -> bool
+{
+    auto const index = page_index(address);
+
+    if (!index || pages[*index] == locked)
+        return false;
+
+    pages[*index] = protection;
+    return true;
+}
+
+auto buffer::page_size() const -> std::size_t
+    { return page; }
+
+/**
+ * Register a module so it can be found by name, e.g. as the target of a forwarder.
+ *
+ * @param name Module file name, e.g. "kernel32.dll".
+ * @param base Pointer to the image base address.
+ */
+auto buffer::add_module(std::string name, std::uint8_t* base) -> void
+    { modules[std::move(name)] = base; }
+
+auto buffer::module(std::string_view name) -> std::uint8_t*
+{
+    auto const it = modules.find(std::string { name });
+    return it != modules.end() ? it->second: nullptr;
+}
+
+auto buffer::module_name(const std::uint8_t* base) -> std::string
+{
+    for (auto&& [name, address]: modules)
+        if (address == base)
+            return name;
+
+    return {};
+}
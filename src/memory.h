@@ -0,0 +1,71 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace mempatcher::memory
+{
+    /**
+     * Access to the memory that patches are read from and written to.
+     * Writes that atomic::fits must not be observable half-done by other threads.
+     */
+    class backend
+    {
+    public:
+        virtual ~backend() = default;
+
+        [[nodiscard]] virtual auto read(const std::uint8_t* address, std::span<std::uint8_t> out) -> bool = 0;
+        [[nodiscard]] virtual auto write(std::uint8_t* address, std::span<const std::uint8_t> data) -> bool = 0;
+        [[nodiscard]] virtual auto fill(std::uint8_t* address, std::uint8_t value, std::size_t count) -> bool = 0;
+        [[nodiscard]] virtual auto checksum(const std::uint8_t* address, std::size_t size) -> std::optional<std::uint32_t> = 0;
+        [[nodiscard]] virtual auto unprotect(std::uint8_t* page) -> std::optional<std::uint32_t> = 0;
+        [[nodiscard]] virtual auto protect(std::uint8_t* page, std::uint32_t protection) -> bool = 0;
+        [[nodiscard]] virtual auto page_size() const -> std::size_t = 0;
+        [[nodiscard]] virtual auto module(std::string_view) -> std::uint8_t* { return nullptr; }
+        [[nodiscard]] virtual auto module_name(const std::uint8_t*) -> std::string { return {}; }
+    };
+
+    /**
+     * Backend over a plain byte buffer with simulated page protection.
+     *
+     * Pages are aligned to the page size like real memory, start out read-only
+     * and have to be unprotected before writing. Individual pages can be
+     * locked to make unprotecting them fail.
+     */
+    class buffer final: public backend
+    {
+    public:
+        explicit buffer(std::span<std::uint8_t> memory, std::size_t page_size = 0x1000);
+
+        auto read(const std::uint8_t* address, std::span<std::uint8_t> out) -> bool override;
+        auto write(std::uint8_t* address, std::span<const std::uint8_t> data) -> bool override;
+        auto fill(std::uint8_t* address, std::uint8_t value, std::size_t count) -> bool override;
+        auto checksum(const std::uint8_t* address, std::size_t size) -> std::optional<std::uint32_t> override;
+        auto unprotect(std::uint8_t* page) -> std::optional<std::uint32_t> override;
+        auto protect(std::uint8_t* page, std::uint32_t protection) -> bool override;
+        auto page_size() const -> std::size_t override;
+        auto module(std::string_view name) -> std::uint8_t* override;
+        auto module_name(const std::uint8_t* base) -> std::string override;
+
+        auto add_module(std::string name, std::uint8_t* base) -> void;
+        auto lock(const std::uint8_t* address) -> void;
+        [[nodiscard]] auto writable(const std::uint8_t* address, std::size_t size = 1) const -> bool;
+
+    private:
+        enum protection: std::uint32_t { read_only, read_write, locked };
+
+        std::span<std::uint8_t> memory;
+        std::size_t page;
+        std::uintptr_t origin;
+        std::vector<std::uint32_t> pages;
+        std::unordered_map<std::string, std::uint8_t*> modules;
+
+        [[nodiscard]] auto contains(const std::uint8_t* address, std::size_t size) const -> bool;
+        [[nodiscard]] auto page_index(const std::uint8_t* address) const -> std::optional<std::size_t>;
+    };
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+/**
+ * C interface to the patch engine, for hosts that link mempatcher_core directly
+ * and already have patch data in memory instead of files on the command line.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct mempatcher_context mempatcher_context;
+typedef struct mempatcher_patch_set mempatcher_patch_set;
+
+typedef enum mempatcher_status
+{
+    MEMPATCHER_OK = 0,
+    MEMPATCHER_INVALID_ARGUMENT,
+    MEMPATCHER_PARSE_FAILED,
+    MEMPATCHER_APPLY_FAILED,
+    MEMPATCHER_REVERT_FAILED,
+    /* an exception, e.g. out of memory, was caught before it could reach the caller */
+    MEMPATCHER_INTERNAL_ERROR,
+} mempatcher_status;
+
+typedef struct mempatcher_error
+{
+    /* parser error code, 0 if the failure was not a parse error */
+    int code;
+    /* line of the failing patch, starting at 1 */
+    size_t line;
+    char message[128];
+} mempatcher_error;
+
+/* parse patch file contents, 'name' is recorded in place of a filename and may be null */
+mempatcher_status mempatcher_parse(const char* text, size_t size, const char* name,
+    mempatcher_patch_set** set, mempatcher_error* error);
+size_t mempatcher_patch_count(const mempatcher_patch_set* set);
+void mempatcher_free_patch_set(mempatcher_patch_set* set);
+
+/* returns null if the context could not be allocated */
+mempatcher_context* mempatcher_create(void);
+void mempatcher_destroy(mempatcher_context* context);
+
+/* takes ownership of the set, which must not be used or freed afterwards, even on failure */
+mempatcher_status mempatcher_register(mempatcher_context* context, mempatcher_patch_set* set);
+
+/* apply every registered patch whose target matches 'module' as a single transaction */
+mempatcher_status mempatcher_apply(mempatcher_context* context, const char* module, void* base,
+    size_t* applied, mempatcher_error* error);
+
+/* undo everything applied through the context, newest first */
+mempatcher_status mempatcher_revert(mempatcher_context* context);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,135 @@
+#include <cstdio>
+#include <string>
+#include <format>
+#include <vector>
+#include <charconv>
+#include <optional>
+#include <algorithm>
+
+#include "pe.h"
+#include "diff.h"
+#include "mapping.h"
+
+using namespace mempatcher;
+
+namespace
+{
+    struct options
+    {
+        std::filesystem::path original;
+        std::filesystem::path modified;
+        std::string target;
+        std::size_t gap {};
+        diff::offsets type { diff::offsets::file };
+    };
+
+    auto constexpr usage =
+        "usage: mph-diff [--gap <bytes>] [--rva] [--target <name>] <original> <modified>\n"
+        "\n"
+        "  --gap <bytes>    merge runs separated by at most this many equal bytes (default 0)\n"
+        "  --rva            write RVAs instead of 'F+' file offsets\n"
+        "  --target <name>  module name for each line (default: original file name)\n";
+
+    /**
+     * Parse command line arguments.
+     *
+     * @return Options if the arguments were valid, otherwise nothing.
+     */
+    auto read_options(int argc, char* argv[]) -> std::optional<options>
+    {
+        auto result = options {};
+        auto paths = std::vector<std::string_view> {};
+
+        for (auto i = 1; i < argc; ++i)
+        {
+            auto const arg = std::string_view { argv[i] };
+
+            if (arg == "--rva")
+                result.type = diff::offsets::rva;
+            else if (arg == "--target" && i + 1 < argc)
+                result.target = argv[++i];
+            else if (arg == "--gap" && i + 1 < argc)
+            {
+                auto const value = std::string_view { argv[++i] };
+                auto const [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), result.gap);
+
+                if (ec != std::errc {} || ptr != value.data() + value.size())
+                    return std::nullopt;
+            }
+            else if (arg.starts_with("--"))
+                return std::nullopt;
+            else
+                paths.push_back(arg);
+        }
+
+        if (paths.size() != 2)
+            return std::nullopt;
+
+        result.original = paths[0];
+        result.modified = paths[1];
+
+        if (result.target.empty())
+            result.target = result.original.filename().string();
+
+        return result;
+    }
+
+    auto print(std::FILE* stream, const std::string& text)
+        { std::fputs(text.c_str(), stream); }
+}
+
+/**
+ * Compare an original and a modified build of a PE file and print
+ * every difference as a patch line with 'on' and 'off' bytes.
+ */
+auto main(int argc, char* argv[]) -> int
+{
+    auto const options = read_options(argc, argv);
+
+    if (!options)
+    {
+        print(stderr, usage);
+        return 2;
+    }
+
+    auto const original = file_mapping::open(options->original);
+    auto const modified = file_mapping::open(options->modified);
+
+    auto const failed = [] (const std::filesystem::path& path, const auto& mapping)
+    {
+        if (!mapping)
+            print(stderr, std::format("failed to open '{}': {}\n", path.string(), mapping.error().message()));
+
+        return !mapping;
+    };
+
+    if (failed(options->original, original) || failed(options->modified, modified))
+        return 1;
+
+    auto const a = original->bytes();
+    auto const b = modified->bytes();
+    auto const image = pe::image { a.data(), a.size(), pe::layout::file };
+
+    if (!image.valid())
+    {
+        print(stderr, std::format("'{}' is not a valid PE file\n", options->original.string()));
+        return 1;
+    }
+
+    // patches cannot grow or shrink a module, only the common part is compared
+    if (a.size() != b.size())
+        print(stderr, std::format("warning: file sizes differ ({:X} and {:X}), comparing the first {:X} bytes\n",
+            a.size(), b.size(), std::min(a.size(), b.size())));
+
+    auto const runs = diff::split_runs(image, diff::find_runs(a, b, options->gap));
+
+    for (auto&& run: runs)
+    {
+        if (auto const line = diff::format_line(image, options->target, run, a, b, options->type))
+            print(stdout, *line + '\n');
+        else
+            print(stderr, std::format("warning: F+{:X} has no RVA, skipped {:X} bytes\n", run.offset, run.size));
+    }
+
+    return 0;
+}
@@ -1,5 +1,9 @@
 #include <ranges>
 #include <fstream>
+#include <spanstream>
+#include <utility>
+#include <iterator>
+#include <algorithm>
 
 #include "parser.h"
 
@@ -13,10 +17,38 @@ namespace mempatcher::parser::detail
         [[nodiscard]] auto name() const noexcept -> const char* override;
         [[nodiscard]] auto message(int c) const -> std::string override;
     };
+
+    /**
+     * Make empty data whose buffers allocate from a resource.
+     *
+     * @param resource Resource the bytes, mask and fills are allocated from.
+     * @return Data without any bytes.
+     */
+    auto empty_data(std::pmr::memory_resource* resource) -> data
+    {
+        return data {
+            .bytes = std::pmr::vector<std::uint8_t> { resource },
+            .mask = std::pmr::vector<std::uint8_t> { resource },
+            .fills = std::pmr::vector<fill> { resource },
+        };
+    }
 }
 
 auto const error_category_instance = detail::error_category {};
 
+auto data::size() const -> std::size_t
+{
+    auto result = bytes.size();
+
+    for (auto&& fill: fills)
+        result += fill.count;
+
+    return result;
+}
+
+auto data::empty() const -> bool
+    { return bytes.empty() && fills.empty(); }
+
 auto patch::type_name() const -> std::string_view
 {
     switch (type)
@@ -24,6 +56,8 @@ auto patch::type_name() const -> std::string_view
         case addr_type::absolute: return "absolute address";
         case addr_type::rva:      return "RVA";
         case addr_type::file:     return "file";
+        case addr_type::symbol:   return "export";
+        case addr_type::iat:      return "import";
     }
 
     return "???";
@@ -31,9 +65,18 @@ auto patch::type_name() const -> std::string_view
 
 auto patch::target_name() const -> std::string
 {
+    if (this->crc && !this->crc->section.empty())
+        return std::format("'{}':{}", this->target, this->crc->section);
+
     if (this->type == addr_type::absolute)
         return std::format("0x{:X}", this->address);
 
+    if (this->type == addr_type::symbol)
+        return std::format("'{}'!{}+0x{:X}", this->target, this->symbol, this->address);
+
+    if (this->type == addr_type::iat)
+        return std::format("'{}':iat:{}!{}", this->target, this->library, this->symbol);
+
     return std::format("'{}'+0x{:X}", this->target, this->address);
 }
 
@@ -65,6 +108,16 @@ auto detail::error_category::message(int c) const -> std::string
             return "The data length is not a multiple of 2";
         case errc::parse_bad_data_bytes:
             return "The data contains invalid bytes";
+        case errc::parse_bad_data_repeat:
+            return "The data contains an invalid repeat count";
+        case errc::parse_bad_checksum_region:
+            return "The checksum region is not a valid section or range";
+        case errc::parse_bad_checksum_value:
+            return "The checksum is not a valid 32-bit hexadecimal number";
+        case errc::parse_bad_retry_deadline:
+            return "The retry deadline is not a valid number of milliseconds";
+        case errc::read_cancelled:
+            return "Reading was stopped before the end of the file";
         default:
             return "???";
     }
@@ -74,9 +127,10 @@ auto detail::error_category::message(int c) const -> std::string
  * Read the target filename from a patch line.
  *
  * @param line The full line to read from.
+ * @param resource Resource the name is allocated from.
  * @return The target if successful, otherwise an error code.
  */
-auto parser::read_target(const std::string& line)
+auto parser::read_target(const std::string& line, std::pmr::memory_resource* resource)
     -> std::expected<read_target_result, errc>
 {
     auto const quoted = line.starts_with('"');
@@ -88,7 +142,7 @@ auto parser::read_target(const std::string& line)
                                           errc::parse_insufficient_args };
 
     return read_target_result {
-        .name = line.substr(start, end - start),
+        .name = std::pmr::string { std::string_view { line }.substr(start, end - start), resource },
         .offset = end + 1
     };
 }
@@ -96,18 +150,68 @@ auto parser::read_target(const std::string& line)
 /**
  * Read offset to target where the patch should be applied.
  *
+ * Offsets starting with '!' are relative to a function exported by the target,
+ * optionally followed by a hexadecimal displacement. (e.g. "!ExportedFunc+1C")
+ * Offsets starting with "iat:" name an import of the target and resolve to
+ * its import address table slot. (e.g. "iat:kernel32.dll!Sleep")
+ *
  * @param offset The offset component from the line.
+ * @param resource Resource the symbol and library names are allocated from.
  * @return The offset if successful, otherwise an error code.
  */
-auto parser::read_offset(const std::string& offset)
+auto parser::read_offset(const std::string& offset, std::pmr::memory_resource* resource)
     -> std::expected<read_offset_result, errc>
 {
+    if (offset.starts_with("iat:"))
+    {
+        auto const bang = offset.find('!', 4);
+
+        if (bang == std::string::npos || bang == 4 || bang + 1 == offset.size())
+            return std::unexpected { errc::parse_bad_offset_address };
+
+        return read_offset_result {
+            .type = addr_type::iat,
+            .address = 0,
+            .symbol = std::pmr::string { std::string_view { offset }.substr(bang + 1), resource },
+            .library = std::pmr::string { std::string_view { offset }.substr(4, bang - 4), resource },
+        };
+    }
+
+    if (offset.starts_with('!'))
+    {
+        auto const plus = offset.find('+', 1);
+        auto result = read_offset_result {
+            .type = addr_type::symbol,
+            .address = 0,
+            .symbol = std::pmr::string { std::string_view { offset }.substr(1, plus - 1), resource },
+            .library = std::pmr::string { resource },
+        };
+
+        if (result.symbol.empty())
+            return std::unexpected { errc::parse_bad_offset_address };
+
+        if (plus == std::string::npos)
+            return result;
+
+        auto const hex = offset.substr(offset.compare(plus + 1, 2, "0x") == 0 ? plus + 3: plus + 1);
+        auto const [ptr, ec] = std::from_chars(hex.data(), hex.data() + hex.size(), result.address, 16);
+
+        if (ec != std::errc {} || ptr != hex.data() + hex.size())
+            return std::unexpected { errc::parse_bad_offset_address };
+
+        return result;
+    }
+
     auto const file = offset.starts_with("f+") || offset.starts_with("F+");
     auto const start = file ? 2: 0;
 
-    auto result = read_offset_result
-        { .type = file ? addr_type::file:
-                         addr_type::rva };
+    auto result = read_offset_result {
+        .type = file ? addr_type::file:
+                       addr_type::rva,
+        .address = 0,
+        .symbol = std::pmr::string { resource },
+        .library = std::pmr::string { resource },
+    };
 
     auto const [_, ec] = std::from_chars(offset.data() + start,
         offset.data() + offset.size(), result.address, 16);
@@ -119,38 +223,226 @@ auto parser::read_offset(const std::string& offset)
 }
 
 /**
- * Convert hex patch data to a vector of bytes.
+ * Read the region covered by a checksum check.
+ *
+ * Either a section name (e.g. ".text") or an offset followed by
+ * a hexadecimal size. (e.g. "F+400:1000" or "A271FC:200")
+ *
+ * @param region The region component from the offset, without the "crc:" prefix.
+ * @param resource Resource the symbol and section names are allocated from.
+ * @return The region if successful, otherwise an error code.
+ */
+auto parser::read_region(const std::string& region, std::pmr::memory_resource* resource)
+    -> std::expected<read_region_result, errc>
+{
+    auto const separator = region.find(':');
+
+    if (separator == std::string::npos)
+    {
+        // section names are at most 8 bytes in the section table
+        if (region.empty() || region.size() > 8)
+            return std::unexpected { errc::parse_bad_checksum_region };
+
+        return read_region_result {
+            .type = addr_type::rva,
+            .address = 0,
+            .symbol = std::pmr::string { resource },
+            .section = std::pmr::string { region, resource },
+            .size = 0,
+        };
+    }
+
+    auto offset = read_offset(region.substr(0, separator), resource);
+
+    if (!offset)
+        return std::unexpected { offset.error() };
+
+    auto result = read_region_result {
+        .type = offset->type,
+        .address = offset->address,
+        .symbol = std::move(offset->symbol),
+        .section = std::pmr::string { resource },
+        .size = 0,
+    };
+
+    auto const size = std::string_view { region }.substr(separator + 1);
+    auto const [ptr, ec] = std::from_chars(size.data(),
+        size.data() + size.size(), result.size, 16);
+
+    if (ec != std::errc {} || ptr != size.data() + size.size() || result.size == 0)
+        return std::unexpected { errc::parse_bad_checksum_region };
+
+    return result;
+}
+
+/**
+ * Read the expected value of a checksum check.
+ *
+ * @param value Up to 8 hexadecimal digits. (e.g. "1A2B3C4D")
+ * @return The checksum if successful, otherwise an error code.
+ */
+auto parser::read_checksum(const std::string& value)
+    -> std::expected<std::uint32_t, errc>
+{
+    auto result = std::uint32_t {};
+
+    if (value.empty() || value.size() > 8)
+        return std::unexpected { errc::parse_bad_checksum_value };
+
+    auto const [ptr, ec] = std::from_chars(value.data(),
+        value.data() + value.size(), result, 16);
+
+    if (ec != std::errc {} || ptr != value.data() + value.size())
+        return std::unexpected { errc::parse_bad_checksum_value };
+
+    return result;
+}
+
+/**
+ * Convert hex patch data to a vector of bytes and fill records.
+ *
+ * A byte followed by '*' and a decimal count is repeated that many times,
+ * e.g. "90*85", for up to 1 MiB of data in total. Segments can be separated with ',' to continue with literal
+ * bytes after a repeat. (e.g. "EB05,90*3,CC")
+ *
+ * "??" is a wildcard byte. Expected data ignores it when comparing and
+ * replacement data leaves the byte in memory as it is. (e.g. "E8????????")
+ * Wildcards are recorded in a mask next to the bytes, which stays empty
+ * unless the data contains at least one.
  *
  * @param bytes A data component from the line. (e.g. "112233445566")
- * @return A vector of bytes if successful, otherwise an error code.
+ * @param resource Resource the bytes, mask and fills are allocated from.
+ * @return Parsed data if successful, otherwise an error code.
  */
-auto parser::read_data(const std::string& bytes)
-    -> std::expected<std::vector<std::uint8_t>, errc>
+auto parser::read_data(const std::string& bytes, std::pmr::memory_resource* resource)
+    -> std::expected<data, errc>
 {
-    if (bytes.size() % 2 != 0)
-        return std::unexpected { errc::parse_bad_data_length };
+    // far beyond any real patch, but small enough that sizes cannot wrap
+    auto constexpr max_size = std::size_t { 1024 * 1024 };
+
+    auto result = detail::empty_data(resource);
+    auto position = std::size_t {};
 
-    auto result = std::vector<std::uint8_t>(bytes.size() / 2);
+    // two digits per byte at most, so the bytes are never reallocated while reading
+    result.bytes.reserve(bytes.size() / 2);
 
-    for (auto i = 0; i < bytes.size(); i += 2)
+    for (auto&& part: bytes | std::views::split(','))
     {
-        auto const [_, ec] = std::from_chars(bytes.data() + i,
-            bytes.data() + i + 2, result[i / 2], 16);
+        auto const segment = std::string_view { part.begin(), part.end() };
+        auto const repeat = segment.find('*');
+        auto const hex = segment.substr(0, repeat);
 
-        if (ec != std::errc {})
-            return std::unexpected { errc::parse_bad_data_bytes };
+        if (hex.size() % 2 != 0)
+            return std::unexpected { errc::parse_bad_data_length };
+
+        if (hex.empty())
+            return std::unexpected { repeat != std::string_view::npos ?
+                errc::parse_bad_data_repeat: errc::parse_bad_data_bytes };
+
+        for (auto i = 0; i < hex.size(); i += 2)
+        {
+            if (hex.substr(i, 2) == "??")
+            {
+                if (result.mask.empty())
+                    result.mask.resize(result.bytes.size(), 0xFF);
+
+                result.bytes.push_back(0x00);
+                result.mask.push_back(0x00);
+                continue;
+            }
+
+            auto value = std::uint8_t {};
+            auto const [ptr, ec] = std::from_chars(hex.data() + i,
+                hex.data() + i + 2, value, 16);
+
+            // a lone '?' is neither a digit nor a wildcard. other trailing characters
+            // have always been ignored (e.g. "1G" is 0x01) and still are
+            auto const partial = ptr != hex.data() + i + 2 && hex.substr(i, 2).contains('?');
+
+            if (ec != std::errc {} || partial)
+                return std::unexpected { errc::parse_bad_data_bytes };
+
+            result.bytes.push_back(value);
+
+            if (!result.mask.empty())
+                result.mask.push_back(0xFF);
+        }
+
+        position += hex.size() / 2;
+
+        if (repeat == std::string_view::npos)
+            continue;
+
+        // last byte before the '*' becomes the fill value
+        auto const count_str = segment.substr(repeat + 1);
+        auto count = std::size_t {};
+        auto const [ptr, ec] = std::from_chars(count_str.data(),
+            count_str.data() + count_str.size(), count, 10);
+
+        if (ec != std::errc {} || ptr != count_str.data() + count_str.size() || count == 0)
+            return std::unexpected { errc::parse_bad_data_repeat };
+
+        // the repeated byte is already counted in the position
+        if (count > max_size || position - 1 + count > max_size)
+            return std::unexpected { errc::parse_bad_data_repeat };
+
+        // fills have a single value, so a wildcard cannot be repeated
+        if (!result.mask.empty() && result.mask.back() == 0x00)
+            return std::unexpected { errc::parse_bad_data_repeat };
+
+        result.fills.push_back({
+            .offset = position - 1,
+            .count = count,
+            .value = result.bytes.back()
+        });
+
+        result.bytes.pop_back();
+
+        if (!result.mask.empty())
+            result.mask.pop_back();
+
+        position += count - 1;
     }
 
     return result;
 }
 
+/**
+ * Read the retry option that can end a patch line.
+ *
+ * "retry" keeps retrying a failed compare for the default deadline, while
+ * "retry:" followed by a decimal number sets the deadline in milliseconds.
+ * (e.g. "retry:30000")
+ *
+ * @param option The last component from the line.
+ * @return How long to keep retrying if successful, otherwise an error code.
+ */
+auto parser::read_retry(const std::string& option)
+    -> std::expected<std::chrono::milliseconds, errc>
+{
+    auto constexpr default_deadline = std::chrono::milliseconds { 10000 };
+
+    if (option == "retry")
+        return default_deadline;
+
+    auto const value = std::string_view { option }.substr(6);
+    auto result = std::chrono::milliseconds::rep {};
+    auto const [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), result, 10);
+
+    if (ec != std::errc {} || ptr != value.data() + value.size() || result <= 0)
+        return std::unexpected { errc::parse_bad_retry_deadline };
+
+    return std::chrono::milliseconds { result };
+}
+
 /**
  * Parse a single line of a memory patch file.
  *
  * @param line The line to parse.
+ * @param resource Resource every string and byte buffer of the patch is allocated from.
  * @return A patch if successful, otherwise an error code.
  */
-auto parser::read_line(const std::string& line)
+auto parser::read_line(const std::string& line, std::pmr::memory_resource* resource)
     -> std::expected<patch, errc>
 {
     // ignore comments and empty lines
@@ -162,20 +454,46 @@ auto parser::read_line(const std::string& line)
         return std::unexpected { errc::parse_line_empty };
 
     // handle target first in case it contains spaces
-    auto target = read_target(line);
+    auto target = read_target(line, resource);
 
     if (!target)
         return std::unexpected { target.error() };
 
-    auto result = patch { .target = std::move(target->name) };
+    // every member starts out on the resource, so moving parts in below keeps them there
+    auto result = patch {
+        .type = addr_type::rva,
+        .line = 0,
+        .file = std::pmr::string { resource },
+        .target = std::move(target->name),
+        .library = std::pmr::string { resource },
+        .symbol = std::pmr::string { resource },
+        .address = 0,
+        .on = detail::empty_data(resource),
+        .off = detail::empty_data(resource),
+        .crc = std::nullopt,
+        .retry = std::nullopt,
+        .order = 0,
+    };
 
     // slice off target and split the rest at spaces
-    auto const args = line
+    auto args = line
         | std::views::drop(target->offset)
         | std::views::split(' ')
         | std::views::filter([] (auto&& v) { return !v.empty(); })
         | std::ranges::to<std::vector<std::string>>();
 
+    // retry option is never valid data, so it can follow either data argument
+    if (args.size() > 2 && (args.back() == "retry" || args.back().starts_with("retry:")))
+    {
+        auto retry = read_retry(args.back());
+
+        if (!retry)
+            return std::unexpected { retry.error() };
+
+        result.retry = *retry;
+        args.pop_back();
+    }
+
     // need at least an offset and some bytes to apply
     if (args.size() < 2)
         return std::unexpected { errc::parse_insufficient_args };
@@ -184,14 +502,51 @@ auto parser::read_line(const std::string& line)
     if (args.size() > 3)
         return std::unexpected { errc::parse_too_many_args };
 
+    // checksum checks take a region and a single expected value
+    if (args[0].starts_with("crc:"))
+    {
+        if (args.size() > 2)
+            return std::unexpected { errc::parse_too_many_args };
+
+        auto region = read_region(args[0].substr(4), resource);
+
+        if (!region)
+            return std::unexpected { region.error() };
+
+        auto value = read_checksum(args[1]);
+
+        if (!value)
+            return std::unexpected { value.error() };
+
+        result.type = result.target == "-" ? addr_type::absolute: region->type;
+        result.address = region->address;
+        result.symbol = std::move(region->symbol);
+        result.crc = checksum {
+            .section = std::move(region->section),
+            .size = region->size,
+            .value = *value,
+        };
+
+        if (result.target == "-" && (!result.crc->section.empty() || region->type == addr_type::symbol))
+            return std::unexpected { errc::parse_bad_checksum_region };
+
+        return result;
+    }
+
     // first part is always the offset
-    auto offset = read_offset(args[0]);
+    auto offset = read_offset(args[0], resource);
 
     if (!offset)
         return std::unexpected { offset.error() };
 
     result.type = offset->type;
     result.address = offset->address;
+    result.symbol = std::move(offset->symbol);
+    result.library = std::move(offset->library);
+
+    // absolute addresses have no module to look up exports or imports in
+    if (result.target == "-" && (result.type == addr_type::symbol || result.type == addr_type::iat))
+        return std::unexpected { errc::parse_bad_offset_address };
 
     if (result.target == "-")
         result.type = addr_type::absolute;
@@ -199,7 +554,7 @@ auto parser::read_line(const std::string& line)
     // second is 'on' bytes, can be '-' for no change
     if (args[1] != "-")
     {
-        if (auto on = read_data(args[1]))
+        if (auto on = read_data(args[1], resource))
             result.on = std::move(*on);
         else
             return std::unexpected { on.error() };
@@ -208,7 +563,7 @@ auto parser::read_line(const std::string& line)
     // third is 'off' bytes, optional
     if (args.size() > 2)
     {
-        if (auto off = read_data(args[2]))
+        if (auto off = read_data(args[2], resource))
             result.off = std::move(*off);
         else
             return std::unexpected { off.error() };
@@ -218,32 +573,86 @@ auto parser::read_line(const std::string& line)
     if (result.on.empty() && result.off.empty())
         return std::unexpected { errc::parse_insufficient_args };
 
+    // import slots hold a single pointer, the exact width is checked against the image later
+    auto const pointer_sized = [] (const data& data)
+        { return data.empty() || data.size() == 4 || data.size() == 8; };
+
+    if (result.type == addr_type::iat && (!pointer_sized(result.on) || !pointer_sized(result.off) ||
+        (!result.on.empty() && !result.off.empty() && result.on.size() != result.off.size())))
+        return std::unexpected { errc::parse_bad_data_length };
+
     return result;
 }
 
+/**
+ * Append a chunk to a patch list, taking over its storage if the list is still empty.
+ *
+ * @param result List to append to.
+ * @param chunk Chunk handed over by read_stream.
+ */
+auto take_chunk(patch_list& result, patch_list&& chunk) -> void
+{
+    // same resource, so this is a pointer swap instead of moving every patch
+    if (result.empty() && result.get_allocator() == chunk.get_allocator())
+        result = std::move(chunk);
+    else
+        std::ranges::move(chunk, std::back_inserter(result));
+}
+
 /**
  * Read memory patches from a file.
  *
  * @param path The path to the file to read.
+ * @param resource Resource the patch list is allocated from.
  * @return A vector of patches if successful, otherwise an error code.
  */
-auto parser::read_file(const std::filesystem::path& path)
-    -> std::expected<std::vector<patch>, parse_error>
+auto parser::read_file(const std::filesystem::path& path, std::pmr::memory_resource* resource)
+    -> std::expected<patch_list, parse_error>
 {
-    if (!exists(path))
-        return std::unexpected { parse_error { errc::file_not_found, 0 } };
+    auto result = patch_list { resource };
 
-    auto file = std::ifstream { path };
+    auto const read = read_file(path, [&] (auto&& chunk)
+    {
+        take_chunk(result, std::move(chunk));
+        return true;
+    }, SIZE_MAX, resource);
 
-    if (!file)
-        return std::unexpected { parse_error { errc::file_open_fail, 0 } };
+    if (!read)
+        return std::unexpected { read.error() };
 
+    return result;
+}
+
+/**
+ * Read memory patches from a stream, handing them over in chunks as they are parsed.
+ *
+ * @param input Stream to read lines from.
+ * @param filename Name recorded in each patch.
+ * @param callback Receives each chunk of patches. Returning false stops reading.
+ * @param chunk_size Maximum number of patches per chunk.
+ * @param resource Resource each chunk is allocated from.
+ * @return Number of patches read if successful, otherwise an error code.
+ */
+auto read_stream(std::istream& input, const std::string& filename, const chunk_callback& callback,
+    std::size_t chunk_size, std::pmr::memory_resource* resource) -> std::expected<std::size_t, parse_error>
+{
     auto nline = std::size_t { 1 };
-    auto result = std::vector<patch> {};
+    auto total = std::size_t {};
+    auto chunk = patch_list { resource };
 
-    for (auto line = std::string {}; std::getline(file, line); ++nline)
+    auto const flush = [&]
     {
-        auto patch = read_line(line);
+        total += chunk.size();
+        return callback(std::exchange(chunk, patch_list { resource }));
+    };
+
+    for (auto line = std::string {}; std::getline(input, line); ++nline)
+    {
+        // text mode only drops carriage returns on Windows, buffers keep them everywhere
+        if (line.ends_with('\r'))
+            line.pop_back();
+
+        auto patch = read_line(line, resource);
 
         if (!patch && patch.error() == errc::parse_line_empty)
             continue;
@@ -252,10 +661,68 @@ auto parser::read_file(const std::filesystem::path& path)
             return std::unexpected { parse_error { patch.error(), nline } };
 
         patch->line = nline;
-        patch->file = path.filename().string();
+        patch->file = filename;
 
-        result.push_back(std::move(*patch));
+        chunk.push_back(std::move(*patch));
+
+        if (chunk.size() >= chunk_size && !flush())
+            return std::unexpected { parse_error { errc::read_cancelled, nline } };
     }
 
+    if (!chunk.empty() && !flush())
+        return std::unexpected { parse_error { errc::read_cancelled, nline } };
+
+    return total;
+}
+
+/**
+ * Read memory patches from a file, handing them over in chunks as they are parsed.
+ *
+ * Lets the caller start applying patches before the rest of the file is read.
+ * Patches handed over before an error are not taken back.
+ *
+ * @param path The path to the file to read.
+ * @param callback Receives each chunk of patches. Returning false stops reading.
+ * @param chunk_size Maximum number of patches per chunk.
+ * @param resource Resource each chunk is allocated from.
+ * @return Number of patches read if successful, otherwise an error code.
+ */
+auto parser::read_file(const std::filesystem::path& path, const chunk_callback& callback, std::size_t chunk_size,
+    std::pmr::memory_resource* resource) -> std::expected<std::size_t, parse_error>
+{
+    if (!exists(path))
+        return std::unexpected { parse_error { errc::file_not_found, 0 } };
+
+    auto file = std::ifstream { path };
+
+    if (!file)
+        return std::unexpected { parse_error { errc::file_open_fail, 0 } };
+
+    return read_stream(file, path.filename().string(), callback, chunk_size, resource);
+}
+
+/**
+ * Read memory patches from text already in memory, without going through a file.
+ *
+ * @param text Contents of a patch file.
+ * @param name Name recorded in each patch in place of a filename.
+ * @param resource Resource the patch list is allocated from.
+ * @return A vector of patches if successful, otherwise an error code.
+ */
+auto parser::read_buffer(std::string_view text, const std::string& name, std::pmr::memory_resource* resource)
+    -> std::expected<patch_list, parse_error>
+{
+    auto result = patch_list { resource };
+    auto input = std::ispanstream { std::span { text.data(), text.size() } };
+
+    auto const read = read_stream(input, name, [&] (auto&& chunk)
+    {
+        take_chunk(result, std::move(chunk));
+        return true;
+    }, SIZE_MAX, resource);
+
+    if (!read)
+        return std::unexpected { read.error() };
+
     return result;
-}
\ No newline at end of file
+}
@@ -1,23 +1,59 @@
 #pragma once
 
+#include <chrono>
 #include <string>
 #include <vector>
+#include <optional>
+#include <string_view>
 #include <expected>
+#include <functional>
 #include <filesystem>
+#include <memory_resource>
 
 namespace mempatcher::parser
 {
-    enum class addr_type { absolute, rva, file };
+    enum class addr_type { absolute, rva, file, symbol, iat };
+
+    struct fill
+    {
+        std::size_t offset;
+        std::size_t count;
+        std::uint8_t value;
+    };
+
+    struct data
+    {
+        std::pmr::vector<std::uint8_t> bytes;
+        std::pmr::vector<std::uint8_t> mask;
+        std::pmr::vector<fill> fills;
+
+        [[nodiscard]] auto size() const -> std::size_t;
+        [[nodiscard]] auto empty() const -> bool;
+    };
+
+    struct checksum
+    {
+        std::pmr::string section;
+        std::size_t size;
+        std::uint32_t value;
+    };
 
     struct patch
     {
         addr_type type;
         std::size_t line;
-        std::string file;
-        std::string target;
+        std::pmr::string file;
+        std::pmr::string target;
+        std::pmr::string library;
+        std::pmr::string symbol;
         std::uintptr_t address;
-        std::vector<std::uint8_t> on;
-        std::vector<std::uint8_t> off;
+        data on;
+        data off;
+        std::optional<checksum> crc;
+        std::optional<std::chrono::milliseconds> retry;
+
+        // position among every patch being applied, so patches grouped by target can go back to file order
+        std::size_t order;
 
         [[nodiscard]] auto type_name() const -> std::string_view;
         [[nodiscard]] auto target_name() const -> std::string;
@@ -34,11 +70,16 @@ namespace mempatcher::parser
         parse_bad_offset_address,
         parse_bad_data_length,
         parse_bad_data_bytes,
+        parse_bad_data_repeat,
+        parse_bad_checksum_region,
+        parse_bad_checksum_value,
+        parse_bad_retry_deadline,
+        read_cancelled,
     };
 
     struct read_target_result
     {
-        std::string name;
+        std::pmr::string name;
         std::string::size_type offset;
     };
 
@@ -46,6 +87,17 @@ namespace mempatcher::parser
     {
         addr_type type;
         std::uintptr_t address;
+        std::pmr::string symbol;
+        std::pmr::string library;
+    };
+
+    struct read_region_result
+    {
+        addr_type type;
+        std::uintptr_t address;
+        std::pmr::string symbol;
+        std::pmr::string section;
+        std::size_t size;
     };
 
     struct parse_error
@@ -54,13 +106,29 @@ namespace mempatcher::parser
         std::size_t line;
     };
 
+    using patch_list = std::pmr::vector<patch>;
+    using chunk_callback = std::function<bool(patch_list&& chunk)>;
+
     auto make_error_code(errc e) -> std::error_code;
 
-    [[nodiscard]] auto read_target(const std::string& line) -> std::expected<read_target_result, errc>;
-    [[nodiscard]] auto read_offset(const std::string& offset) -> std::expected<read_offset_result, errc>;
-    [[nodiscard]] auto read_data(const std::string& bytes) -> std::expected<std::vector<std::uint8_t>, errc>;
-    [[nodiscard]] auto read_line(const std::string& line) -> std::expected<patch, errc>;
-    [[nodiscard]] auto read_file(const std::filesystem::path& path) -> std::expected<std::vector<patch>, parse_error>;
+    [[nodiscard]] auto read_target(const std::string& line,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()) -> std::expected<read_target_result, errc>;
+    [[nodiscard]] auto read_offset(const std::string& offset,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()) -> std::expected<read_offset_result, errc>;
+    [[nodiscard]] auto read_region(const std::string& region,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()) -> std::expected<read_region_result, errc>;
+    [[nodiscard]] auto read_checksum(const std::string& value) -> std::expected<std::uint32_t, errc>;
+    [[nodiscard]] auto read_data(const std::string& bytes,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()) -> std::expected<data, errc>;
+    [[nodiscard]] auto read_retry(const std::string& option) -> std::expected<std::chrono::milliseconds, errc>;
+    [[nodiscard]] auto read_line(const std::string& line,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()) -> std::expected<patch, errc>;
+    [[nodiscard]] auto read_file(const std::filesystem::path& path,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()) -> std::expected<patch_list, parse_error>;
+    [[nodiscard]] auto read_file(const std::filesystem::path& path, const chunk_callback& callback, std::size_t chunk_size,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()) -> std::expected<std::size_t, parse_error>;
+    [[nodiscard]] auto read_buffer(std::string_view text, const std::string& name,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()) -> std::expected<patch_list, parse_error>;
 }
 
 template <> struct std::is_error_code_enum<mempatcher::parser::errc>: true_type {};
\ No newline at end of file
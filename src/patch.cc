@@ -1,52 +1,262 @@
 #include <span>
+#include <array>
+#include <string>
+#include <ranges>
+#include <cstring>
+#include <algorithm>
 
 #include "patch.h"
+#include "atomic.h"
+#include "compare.h"
+#include "checksum.h"
 
 using namespace mempatcher;
+using namespace mempatcher::patch;
 
 /**
- * Converts a file offset to a relative virtual address.
+ * Walk the literal and fill runs of patch data in order.
  *
- * @param base Pointer to the image base address.
- * @param offset File offset to convert.
- * @return Relative virtual address, or nullptr if the offset was invalid.
+ * @param data Patch data to walk.
+ * @param literal Callback for literal runs, receives offset, source and size.
+ * @param fill Callback for fill runs, receives offset, value and count.
+ * @return True if every callback returned true, false otherwise.
  */
-auto file2rva(std::uint8_t* base, std::uintptr_t offset) -> std::uint8_t*
+template <typename Literal, typename Fill>
+auto walk_data(const parser::data& data, Literal&& literal, Fill&& fill) -> bool
 {
-    auto const dos = reinterpret_cast<PIMAGE_DOS_HEADER>(base);
+    auto position = std::size_t {};
+    auto source = data.bytes.data();
+
+    for (auto&& run: data.fills)
+    {
+        auto const size = run.offset - position;
 
-    if (dos->e_magic != IMAGE_DOS_SIGNATURE)
-        return nullptr;
+        if (size != 0 && !literal(position, source, size))
+            return false;
 
-    auto const nt = reinterpret_cast<PIMAGE_NT_HEADERS>(base + dos->e_lfanew);
+        if (!fill(run.offset, run.value, run.count))
+            return false;
 
-    if (nt->Signature != IMAGE_NT_SIGNATURE)
-        return nullptr;
+        source += size;
+        position = run.offset + run.count;
+    }
+
+    auto const size = static_cast<std::size_t>(data.bytes.data() + data.bytes.size() - source);
 
-    auto const sections = IMAGE_FIRST_SECTION(nt);
+    return size == 0 || literal(position, source, size);
+}
 
-    if (offset < sections->PointerToRawData)
-        return base + offset;
+/**
+ * Compare memory to patch data without materializing fill runs.
+ * Wildcard bytes are skipped with a masked compare.
+ *
+ * @param target Pointer to the memory location.
+ * @param data Patch data to compare against.
+ * @return True if the data matches, false otherwise.
+ */
+auto equal_data(const std::uint8_t* target, const parser::data& data)
+{
+    return walk_data(data,
+        [&] (auto offset, auto source, auto size)
+        {
+            if (data.mask.empty())
+                return std::memcmp(target + offset, source, size) == 0;
+
+            auto const mask = data.mask.data() + (source - data.bytes.data());
+            return compare::masked_equal(target + offset, source, mask, size);
+        },
+        [&] (auto offset, auto value, auto count)
+            { return std::all_of(target + offset, target + offset + count,
+                [&] (auto byte) { return byte == value; }); });
+}
+
+/**
+ * Compare data read from memory to the expected data from patch.
+ * Data that is already patched matches as well.
+ *
+ * @param current Bytes currently in memory, at least as long as the patch data.
+ * @param patch Patch containing the expected data.
+ * @return True if the data matches, false otherwise.
+ */
+auto patch::matches(const std::uint8_t* current, const parser::patch& patch) -> bool
+{
+    if (patch.off.empty())
+        return true;
 
-    for (auto i = 0; i < nt->FileHeader.NumberOfSections; ++i)
+    if (equal_data(current, patch.off))
+        return true;
+
+    if (!patch.on.empty() && equal_data(current, patch.on))
     {
-        auto const section = sections + i;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Check that the data of an import slot patch covers exactly one pointer.
+ *
+ * @param patch Patch to check.
+ * @param width Pointer size of the image, 4 or 8.
+ * @return True if both the replacement and expected data are pointer sized or empty.
+ */
+auto patch::fits_slot(const parser::patch& patch, std::size_t width) -> bool
+{
+    return (patch.on.empty() || patch.on.size() == width) &&
+           (patch.off.empty() || patch.off.size() == width);
+}
 
-        if (offset >= section->PointerToRawData && offset < section->PointerToRawData + section->SizeOfRawData)
-            return base + section->VirtualAddress + (offset - section->PointerToRawData);
+/**
+ * Copy the first bytes of patch data into a buffer.
+ *
+ * @param data Patch data to copy from.
+ * @param out Buffer to fill, at most as long as the data.
+ */
+auto copy_head(const parser::data& data, std::span<std::uint8_t> out)
+{
+    walk_data(data,
+        [&] (auto offset, auto source, auto size)
+        {
+            if (offset < out.size())
+                std::memcpy(out.data() + offset, source, std::min(size, out.size() - offset));
+
+            return offset + size < out.size();
+        },
+        [&] (auto offset, auto value, auto count)
+        {
+            if (offset < out.size())
+                std::memset(out.data() + offset, value, std::min(count, out.size() - offset));
+
+            return offset + count < out.size();
+        });
+}
+
+/**
+ * Expand patch data into plain bytes, keeping the current bytes wherever the data has a wildcard.
+ *
+ * @param data Patch data to expand.
+ * @param current Bytes currently in memory, as long as the data.
+ * @return Bytes to write.
+ */
+auto merge_data(const parser::data& data, std::span<const std::uint8_t> current)
+{
+    auto result = std::vector<std::uint8_t>(current.begin(), current.end());
+
+    walk_data(data,
+        [&] (auto offset, auto source, auto size)
+        {
+            auto const mask = data.mask.data() + (source - data.bytes.data());
+
+            for (auto i = std::size_t {}; i < size; ++i)
+                if (mask[i])
+                    result[offset + i] = source[i];
+
+            return true;
+        },
+        [&] (auto offset, auto value, auto count)
+        {
+            std::memset(result.data() + offset, value, count);
+            return true;
+        });
+
+    return result;
+}
+
+/**
+ * Write a range that is too large for a single store without exposing a torn instruction.
+ *
+ * The head is first replaced with 'jmp $', so any thread reaching the start of the
+ * range spins there while the tail is written. The real head is swapped in last.
+ * Threads already executing inside the tail are not covered, just like the
+ * previous plain copy. If the head itself cannot be stored at once, it is still
+ * written last, so a thread never runs the new head into the old tail.
+ *
+ * @param memory Memory backend to write through.
+ * @param target Pointer to the memory location.
+ * @param head First two bytes of the new data.
+ * @param tail Callback that writes everything after the head.
+ * @return True if the data was successfully written, false otherwise.
+ */
+template <typename Tail>
+auto write_parked(memory::backend& memory, std::uint8_t* target, std::span<const std::uint8_t, 2> head, Tail&& tail)
+{
+    auto constexpr park = std::array<std::uint8_t, 2> { 0xEB, 0xFE };
+
+    // without an atomic head store, parking would not help
+    if (!atomic::fits(target, park.size()))
+        return tail() && memory.write(target, head);
+
+    return memory.write(target, park) && tail() && memory.write(target, head);
+}
+
+/**
+ * Write patch data to memory, using fills for repeated runs.
+ *
+ * Data that fits in one aligned word or block is written with a single atomic store,
+ * anything larger goes through write_parked, so patches can be applied to live code.
+ *
+ * @param memory Memory backend to write through.
+ * @param target Pointer to the memory location.
+ * @param data Patch data to write.
+ * @return True if the data was successfully written, false otherwise.
+ */
+auto write_data(memory::backend& memory, std::uint8_t* target, const parser::data& data)
+{
+    auto buffer = std::array<std::uint8_t, atomic::max_store> {};
+    auto const size = data.size();
+
+    if (size <= buffer.size() && atomic::fits(target, size))
+    {
+        copy_head(data, { buffer.data(), size });
+        return memory.write(target, { buffer.data(), size });
     }
 
-    return nullptr;
+    copy_head(data, { buffer.data(), 2 });
+
+    return write_parked(memory, target, std::span { buffer }.first<2>(), [&]
+    {
+        // everything except the first two bytes, which are written last
+        return walk_data(data,
+            [&] (auto offset, auto source, auto size)
+            {
+                auto const skip = offset < 2 ? std::min<std::size_t>(size, 2 - offset): 0;
+                return size == skip || memory.write(target + offset + skip, { source + skip, size - skip });
+            },
+            [&] (auto offset, auto value, auto count)
+            {
+                auto const skip = offset < 2 ? std::min<std::size_t>(count, 2 - offset): 0;
+                return count == skip || memory.fill(target + offset + skip, value, count - skip);
+            });
+    });
+}
+
+/**
+ * Write raw bytes to memory with the same tear-free guarantees as patch data.
+ *
+ * @param memory Memory backend to write through.
+ * @param target Pointer to the memory location.
+ * @param bytes Bytes to write.
+ * @return True if the bytes were successfully written, false otherwise.
+ */
+auto write_bytes(memory::backend& memory, std::uint8_t* target, std::span<const std::uint8_t> bytes)
+{
+    if (bytes.size() < 2 || (bytes.size() <= atomic::max_store && atomic::fits(target, bytes.size())))
+        return memory.write(target, bytes);
+
+    return write_parked(memory, target, bytes.first<2>(), [&]
+        { return memory.write(target + 2, bytes.subspan(2)); });
 }
 
 /**
  * Resolve patch address to a location in memory.
  *
+ * @param image View of the image the patch applies to.
  * @param base Pointer to the image base address.
  * @param patch Patch containing the address.
  * @return Final address for the patch, or nullptr if an error occurred.
  */
-auto resolve_address(std::uint8_t* base, const parser::patch& patch) -> std::uint8_t*
+auto resolve_address(const pe::image& image, std::uint8_t* base, const parser::patch& patch) -> std::uint8_t*
 {
     if (patch.type == parser::addr_type::absolute)
         return reinterpret_cast<std::uint8_t*>(patch.address);
@@ -56,106 +266,637 @@ auto resolve_address(std::uint8_t* base, const parser::patch& patch) -> std::uin
 
     if (patch.type == parser::addr_type::file)
     {
-        auto const result = file2rva(base, patch.address);
+        auto const result = image.file2rva(patch.address);
 
         if (!result)
         {
             return nullptr;
         }
 
-        return result;
+        return base + *result;
     }
 
     return nullptr;
 }
 
 /**
- * Compare data in memory to the expected data from patch.
+ * Collect the start addresses of every page covered by a set of ranges.
  *
- * @param target Pointer to the memory location.
- * @param patch Patch containing the expected data.
- * @return True if the data matches, false otherwise.
+ * @param memory Memory backend that determines the page size.
+ * @param ranges Address and size of each range.
+ * @return Sorted, unique page addresses.
  */
-auto compare_data(std::uint8_t* target, const parser::patch& patch)
+auto collect_pages(const memory::backend& memory, std::span<const journal::entry> ranges)
 {
-    if (std::memcmp(target, patch.off.data(), patch.off.size()) == 0)
-        return true;
+    auto const page = memory.page_size();
+    auto result = std::vector<std::uint8_t*> {};
 
-    if (!patch.on.empty() && std::memcmp(target, patch.on.data(), patch.on.size()) == 0)
+    for (auto&& range: ranges)
     {
-        return true;
+        auto const first = reinterpret_cast<std::uintptr_t>(range.address) & ~(page - 1);
+        auto const last = reinterpret_cast<std::uintptr_t>(range.address) + range.size;
+
+        for (auto address = first; address < last; address += page)
+            result.push_back(reinterpret_cast<std::uint8_t*>(address));
     }
 
-    return false;
+    std::ranges::sort(result);
+    result.erase(std::ranges::unique(result).begin(), result.end());
+
+    return result;
 }
 
 /**
- * Compare patch data while handling SEH exceptions.
+ * Run a callback with every page of a set of ranges made writable.
+ * Each page is unprotected once and restored to its own previous protection.
  *
- * @param target Pointer to the memory location.
- * @param patch Patch containing the expected data.
- * @return True if the data matches, false otherwise.
+ * @param memory Memory backend to change protection through.
+ * @param ranges Address and size of each range that will be written.
+ * @param callback Callback that performs the writes.
+ * @return True if the pages were unprotected, restored and the callback succeeded.
  */
-auto try_compare_data(std::uint8_t* target, const parser::patch& patch)
+template <typename Callback>
+auto with_unprotected(memory::backend& memory, std::span<const journal::entry> ranges, Callback&& callback)
 {
-    if (patch.off.empty())
-        return true;
+    /**
+     * Restores every page that was unprotected, also when the callback throws.
+     */
+    struct protection_guard
+    {
+        memory::backend& memory;
+        const std::vector<std::uint8_t*>& pages;
+        const std::vector<std::uint32_t>& protections;
+        bool& restored;
+
+        ~protection_guard()
+        {
+            for (auto i = std::size_t {}; i < protections.size(); ++i)
+                restored = memory.protect(pages[i], protections[i]) && restored;
+        }
+    };
+
+    auto const pages = collect_pages(memory, ranges);
+    auto protections = std::vector<std::uint32_t> {};
+    auto restored = true;
+    auto result = false;
+
+    // nothing may allocate once the first page is writable
+    protections.reserve(pages.size());
 
-    __try
-        { return compare_data(target, patch); }
-    __except (EXCEPTION_EXECUTE_HANDLER)
     {
-        return false;
+        auto const guard = protection_guard { memory, pages, protections, restored };
+
+        for (auto&& page: pages)
+        {
+            auto const old = memory.unprotect(page);
+
+            if (!old)
+                break;
+
+            protections.push_back(*old);
+        }
+
+        result = protections.size() == pages.size() && callback();
     }
+
+    return result && restored;
 }
 
 /**
- * Apply patched bytes to the specified address.
+ * Create an empty transaction.
  *
- * @param target Pointer to the memory location.
- * @param patch Patch containing the data to write.
- * @return True if the data was successfully written, false otherwise.
+ * @param memory Memory backend the patches are applied through.
+ * @param cache Resolved address cache to read and update, or nullptr to always resolve.
+ */
+transaction::transaction(memory::backend& memory, cache::store* cache):
+    memory { &memory }, resolved { cache } {}
+
+/**
+ * Add a patch to the transaction. Must be called before preparing.
+ *
+ * @param base Pointer to the image base address.
+ * @param patch Patch to apply. Must outlive the transaction.
+ */
+auto transaction::add(std::uint8_t* base, const parser::patch& patch) -> void
+{
+    steps.push_back({ .base = base, .patch = &patch, .address = nullptr,
+        .planned = false, .verified = false, .projection = 0 });
+    prepared = false;
+}
+
+/**
+ * Add a patch whose address was planned ahead of loading. Must be called before preparing.
+ * The plan has to be for the build of the module at the base address.
+ *
+ * @param base Pointer to the image base address.
+ * @param patch Patch to apply. Must outlive the transaction.
+ * @param planned Planned address, and whether the expected data is already verified.
+ */
+auto transaction::add(std::uint8_t* base, const parser::patch& patch, const plan::step& planned) -> void
+{
+    steps.push_back({ .base = base, .patch = &patch, .address = base + planned.rva,
+        .planned = true, .verified = planned.verified, .projection = 0 });
+    prepared = false;
+}
+
+/**
+ * Get a cached view of the image at a base address.
+ *
+ * @param base Pointer to the image base address.
+ * @return View of the image.
+ */
+auto transaction::image(std::uint8_t* base) -> const pe::image&
+{
+    auto const it = std::ranges::find(images, base, &pe::image::data);
+
+    if (it != images.end())
+        return *it;
+
+    return images.emplace_back(pe::image::from_module(base));
+}
+
+/**
+ * Get a cached export index of the image at a base address.
+ *
+ * @param base Pointer to the image base address.
+ * @return Export index of the image.
+ */
+auto transaction::symbols(std::uint8_t* base) -> const pe::export_index&
+{
+    auto const it = std::ranges::find(exports, base, &decltype(exports)::value_type::first);
+
+    if (it != exports.end())
+        return it->second;
+
+    return exports.emplace_back(base, pe::export_index { image(base) }).second;
+}
+
+/**
+ * Get a cached import index of the image at a base address.
+ *
+ * @param base Pointer to the image base address.
+ * @return Import index of the image.
+ */
+auto transaction::slots(std::uint8_t* base) -> const pe::import_index&
+{
+    auto const it = std::ranges::find(imports, base, &decltype(imports)::value_type::first);
+
+    if (it != imports.end())
+        return it->second;
+
+    return imports.emplace_back(base, pe::import_index { image(base) }).second;
+}
+
+/**
+ * Get the cached address cache key of the module at a base address.
+ * Looking up the module name goes through the loader, so it is done once per module.
+ *
+ * @param base Pointer to the image base address.
+ * @return Key of the module, with an empty name if it is not a known module.
+ */
+auto transaction::cache_key(std::uint8_t* base) -> const cache::key&
+{
+    auto const it = std::ranges::find(keys, base, &decltype(keys)::value_type::first);
+
+    if (it != keys.end())
+        return it->second;
+
+    auto key = cache::key { .module = memory->module_name(base), .build = image(base).build() };
+    return keys.emplace_back(base, std::move(key)).second;
+}
+
+/**
+ * Find the address of an exported name, following forwarders to other loaded modules.
+ *
+ * @param base Pointer to the image base address of the exporting module.
+ * @param name Exported name.
+ * @return Address of the export, or nullptr if it could not be resolved.
  */
-auto write_data(std::uint8_t* target, const parser::patch& patch)
+auto transaction::find_export(std::uint8_t* base, std::string_view name) -> std::uint8_t*
 {
-    auto old = DWORD {};
+    // forwarder chains are short in practice, anything longer is likely a cycle
+    auto constexpr max_depth = 8;
 
-    if (!VirtualProtect(target, patch.on.size(), PAGE_EXECUTE_READWRITE, &old))
+    for (auto depth = 0; base && depth < max_depth; ++depth)
     {
-        return false;
+        auto const entry = symbols(base).find(name);
+
+        if (!entry)
+            return nullptr;
+
+        if (entry->forwarder.empty())
+            return base + entry->rva;
+
+        // forwarders look like "NTDLL.RtlAllocateHeap", ordinal forwarders are not supported
+        auto const dot = entry->forwarder.rfind('.');
+
+        if (dot == std::string_view::npos || dot + 1 == entry->forwarder.size() || entry->forwarder[dot + 1] == '#')
+            return nullptr;
+
+        auto module = std::string { entry->forwarder.substr(0, dot) };
+
+        if (module.find('.') == std::string::npos)
+            module += ".dll";
+
+        name = entry->forwarder.substr(dot + 1);
+        base = memory->module(module);
     }
 
-    std::memcpy(target, patch.on.data(), patch.on.size());
+    return nullptr;
+}
 
-    if (!VirtualProtect(target, patch.on.size(), old, &old))
+/**
+ * Resolve patch address to a location in memory, looking up exports and imports when needed.
+ *
+ * @param base Pointer to the image base address.
+ * @param patch Patch containing the address.
+ * @return Final address for the patch, or nullptr if an error occurred.
+ */
+auto transaction::lookup(std::uint8_t* base, const parser::patch& patch) -> std::uint8_t*
+{
+    if (patch.type == parser::addr_type::symbol)
     {
-        return false;
+        auto const address = find_export(base, patch.symbol);
+        return address ? address + patch.address: nullptr;
     }
 
-    return true;
+    if (patch.type == parser::addr_type::iat)
+    {
+        // anything longer would spill into the next slot
+        if (!fits_slot(patch, image(base).pointer_size()))
+            return nullptr;
+
+        auto const slot = slots(base).find(patch.library, patch.symbol);
+        return slot ? base + *slot: nullptr;
+    }
+
+    auto const needs_image = patch.type == parser::addr_type::file;
+    auto const empty = pe::image { nullptr, 0 };
+
+    return resolve_address(needs_image ? image(base): empty, base, patch);
 }
 
 /**
- * Applies a patch to the specified address.
+ * Resolve patch address, going through the address cache when one is attached.
+ *
+ * Only addresses that need the image headers are cached, and only if they land
+ * inside the module itself, since forwarded exports depend on other builds.
  *
  * @param base Pointer to the image base address.
- * @param patch Patch to apply.
- * @return True if the patch was successfully applied, false otherwise.
+ * @param patch Patch containing the address.
+ * @return Final address for the patch, or nullptr if an error occurred.
+ */
+auto transaction::resolve(std::uint8_t* base, const parser::patch& patch) -> std::uint8_t*
+{
+    auto const cacheable = patch.type == parser::addr_type::file ||
+        patch.type == parser::addr_type::symbol || patch.type == parser::addr_type::iat;
+
+    if (!resolved || !cacheable)
+        return lookup(base, patch);
+
+    // copied out, resolving a forwarder can add images and move the cached views.
+    // keys are only added here, so the reference stays valid
+    auto const size = image(base).size();
+    auto const& key = cache_key(base);
+
+    if (key.module.empty())
+        return lookup(base, patch);
+
+    auto const hash = cache::hash(patch);
+
+    if (auto const rva = resolved->find(key, hash))
+        return base + *rva;
+
+    auto const address = lookup(base, patch);
+
+    if (address && address >= base && address < base + size)
+        resolved->insert(key, hash, static_cast<std::uintptr_t>(address - base));
+
+    return address;
+}
+
+/**
+ * Resolve the address of a step and verify the data currently in memory.
+ *
+ * @param step Step to verify.
+ * @return True if the step can be applied, false otherwise.
  */
-auto patch::apply(std::uint8_t* base, const parser::patch& patch) -> bool
+auto transaction::verify(step& step) -> bool
 {
-    auto const address = resolve_address(base, patch);
+    auto const& patch = *step.patch;
 
-    if (!address)
+    if (patch.crc)
+    {
+        auto address = resolve(step.base, patch);
+        auto size = patch.crc->size;
+
+        if (!patch.crc->section.empty())
+        {
+            auto const section = image(step.base).find_section(patch.crc->section);
+
+            if (!section)
+                return false;
+
+            address = step.base + section->virtual_address;
+            size = section->virtual_size;
+        }
+
+        if (!address)
+            return false;
+
+        if (!touched(address, size))
+            return memory->checksum(address, size) == patch.crc->value;
+
+        // lines after earlier patches have always checked the patched bytes
+        auto current = std::vector<std::uint8_t>(size);
+
+        if (!memory->read(address, current))
+            return false;
+
+        overlay(address, current);
+
+        return checksum::crc32c(current) == patch.crc->value;
+    }
+
+    if (!step.planned)
+        step.address = resolve(step.base, patch);
+
+    if (!step.address)
+        return false;
+
+    auto current = std::vector<std::uint8_t>(std::max(patch.on.size(), patch.off.size()));
+
+    // a plan only verified the file, not what other steps of this transaction write first
+    auto const compare = !patch.off.empty() && (!step.verified || touched(step.address, patch.off.size()));
+
+    // wildcards in the replacement keep whatever is there, so it is needed for the projection too
+    if ((compare || !patch.on.mask.empty()) && !memory->read(step.address, current))
         return false;
 
-    if (!try_compare_data(address, patch))
+    // later lines may expect what earlier lines of the same transaction write
+    overlay(step.address, current);
+
+    if (compare && !matches(current.data(), patch))
         return false;
 
-    if (patch.on.empty())
+    step.projection = project(step.address, patch.on, current);
+    return true;
+}
+
+/**
+ * Check whether any earlier step will write inside a range.
+ *
+ * @param address Start of the range.
+ * @param size Size of the range.
+ * @return True if the range overlaps a projected write, false otherwise.
+ */
+auto transaction::touched(const std::uint8_t* address, std::size_t size) const -> bool
+{
+    auto const start = reinterpret_cast<std::uintptr_t>(address);
+    auto const first = projected_at.lower_bound(start - std::min<std::uintptr_t>(start, longest));
+    auto const last = projected_at.lower_bound(start + size);
+
+    return std::any_of(first, last, [&] (auto&& entry)
+        { return entry.first + projected[entry.second].bytes.size() > start; });
+}
+
+/**
+ * Replace bytes read from memory with what earlier steps will have written there by then.
+ *
+ * @param address Address the bytes were read from.
+ * @param current Bytes read from memory, updated in place.
+ */
+auto transaction::overlay(std::uint8_t* address, std::span<std::uint8_t> current) const -> void
+{
+    if (projected.empty() || current.empty())
+        return;
+
+    auto const start = reinterpret_cast<std::uintptr_t>(address);
+    auto const end = start + current.size();
+    auto const first = projected_at.lower_bound(start - std::min<std::uintptr_t>(start, longest));
+    auto const last = projected_at.lower_bound(end);
+
+    auto overlapping = std::vector<std::size_t> {};
+
+    for (auto it = first; it != last; ++it)
+        if (it->first + projected[it->second].bytes.size() > start)
+            overlapping.push_back(it->second);
+
+    // applied in step order, so the last write to a byte wins
+    std::ranges::sort(overlapping);
+
+    for (auto&& index: overlapping)
     {
+        auto const& write = projected[index];
+        auto const from = std::max(start, reinterpret_cast<std::uintptr_t>(write.address));
+        auto const to = std::min(end, reinterpret_cast<std::uintptr_t>(write.address) + write.bytes.size());
+
+        std::memcpy(current.data() + (from - start),
+            write.bytes.data() + (from - reinterpret_cast<std::uintptr_t>(write.address)), to - from);
+    }
+}
+
+/**
+ * Remember the bytes a step will write, for verifying the steps after it.
+ * These are also the exact bytes that commit writes for data with wildcards.
+ *
+ * @param address Address the step writes to.
+ * @param on Replacement data of the step.
+ * @param current Bytes at the address before the step is written, at least as long as the data.
+ * @return Index of the projection, or zero if the step writes nothing.
+ */
+auto transaction::project(std::uint8_t* address, const parser::data& on, std::span<const std::uint8_t> current)
+    -> std::size_t
+{
+    if (on.empty())
+        return 0;
+
+    auto bytes = std::vector<std::uint8_t>(on.size());
+
+    if (on.mask.empty())
+        copy_head(on, bytes);
+    else
+        bytes = merge_data(on, current.first(on.size()));
+
+    longest = std::max(longest, bytes.size());
+    projected_at.emplace(reinterpret_cast<std::uintptr_t>(address), projected.size());
+    projected.push_back({ .address = address, .bytes = std::move(bytes) });
+
+    return projected.size() - 1;
+}
+
+/**
+ * Phase one: resolve every address and verify all expected data. Nothing is written.
+ *
+ * @return True if every patch can be applied, false otherwise.
+ */
+auto transaction::prepare() -> bool
+{
+    failure = nullptr;
+    prepared = false;
+
+    if (committed)
+        return false;
+
+    projected.clear();
+    projected_at.clear();
+    longest = 0;
+
+    // callers may add patches grouped by target, but they take effect in file order
+    auto const order = [] (const step& step) { return step.patch->order; };
+
+    if (!std::ranges::is_sorted(steps, {}, order))
+        std::ranges::stable_sort(steps, {}, order);
+
+    for (auto&& step: steps)
+    {
+        if (!verify(step))
+        {
+            failure = step.patch;
+            return false;
+        }
+    }
+
+    prepared = true;
+    return true;
+}
+
+/**
+ * Phase two: write every patch in a single protection window, journaling the original bytes.
+ * If anything fails, the journal is used to restore memory before returning. Everything
+ * is allocated before the window opens, so nothing inside it can throw.
+ *
+ * @return True if every patch was written, false otherwise.
+ */
+auto transaction::commit() -> bool
+{
+    if (!prepared || committed)
+        return false;
+
+    log = {};
+
+    for (auto&& step: steps)
+    {
+        if (step.patch->on.empty())
+            continue;
+
+        log.entries.push_back({ .address = step.address,
+            .offset = log.bytes.size(), .size = step.patch->on.size() });
+        log.bytes.resize(log.bytes.size() + step.patch->on.size());
+    }
+
+    auto written = std::size_t {};
+
+    auto const result = with_unprotected(*memory, log.entries, [&]
+    {
+        for (auto&& step: steps)
+        {
+            if (step.patch->on.empty())
+                continue;
+
+            auto const& entry = log.entries[written];
+            auto const original = std::span { log.bytes }.subspan(entry.offset, entry.size);
+
+            if (!memory->read(step.address, original))
+                return false;
+
+            ++written;
+
+            // wildcards keep the bytes that were there, merged in while preparing
+            auto const& on = step.patch->on;
+            auto const ok = on.mask.empty() ? write_data(*memory, step.address, on):
+                write_bytes(*memory, step.address, projected[step.projection].bytes);
+
+            if (!ok)
+                return false;
+        }
+
+        return true;
+    });
+
+    if (result)
+    {
+        committed = true;
         return true;
     }
 
-    return write_data(address, patch);
-}
\ No newline at end of file
+    // only restore what was actually overwritten
+    log.entries.resize(written);
+    restore();
+    log = {};
+
+    return false;
+}
+
+/**
+ * Write the journaled original bytes back in reverse order.
+ *
+ * @return True if every entry was restored, false otherwise.
+ */
+auto transaction::restore() -> bool
+    { return revert(*memory, log); }
+
+/**
+ * Undo a committed transaction by restoring the journaled original bytes.
+ *
+ * @return True if memory was restored, false otherwise.
+ */
+auto transaction::rollback() -> bool
+{
+    if (!committed)
+        return false;
+
+    committed = false;
+    prepared = false;
+
+    auto const result = restore();
+    log = {};
+
+    return result;
+}
+
+auto transaction::size() const -> std::size_t
+    { return steps.size(); }
+
+auto transaction::failed() const -> const parser::patch*
+    { return failure; }
+
+auto transaction::changes() const -> const journal&
+    { return log; }
+
+/**
+ * Write the original bytes from a journal back in reverse order.
+ * Only needs the journal, so changes can be undone after the patches themselves are gone.
+ *
+ * @param memory Memory backend to write through.
+ * @param changes Journal of a committed transaction.
+ * @return True if every entry was restored, false otherwise.
+ */
+auto patch::revert(memory::backend& memory, const journal& changes) -> bool
+{
+    return with_unprotected(memory, changes.entries, [&]
+    {
+        auto result = true;
+
+        for (auto&& entry: changes.entries | std::views::reverse)
+            result = write_bytes(memory, entry.address, std::span { changes.bytes }.subspan(entry.offset, entry.size)) && result;
+
+        return result;
+    });
+}
+
+/**
+ * Applies a single patch to the specified address.
+ *
+ * @param base Pointer to the image base address.
+ * @param patch Patch to apply.
+ * @param memory Memory backend to apply the patch through.
+ * @return True if the patch was successfully applied, false otherwise.
+ */
+auto patch::apply(std::uint8_t* base, const parser::patch& patch, memory::backend& memory) -> bool
+{
+    auto transaction = patch::transaction { memory };
+    transaction.add(base, patch);
+
+    return transaction.prepare() && transaction.commit();
+}
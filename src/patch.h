@@ -1,8 +1,107 @@
 #pragma once
 
+#include <map>
+#include <span>
+
+#include "pe.h"
+#include "cache.h"
+#include "plan.h"
+#include "memory.h"
 #include "parser.h"
 
 namespace mempatcher::patch
 {
-    [[nodiscard]] auto apply(std::uint8_t* base, const parser::patch& patch) -> bool;
-}
\ No newline at end of file
+    /**
+     * Original bytes of every location written by a transaction.
+     */
+    struct journal
+    {
+        struct entry
+        {
+            std::uint8_t* address;
+            std::size_t offset;
+            std::size_t size;
+        };
+
+        std::vector<entry> entries;
+        std::vector<std::uint8_t> bytes;
+    };
+
+    /**
+     * Applies a group of patches, usually everything for one module, as a single unit.
+     *
+     * Preparing resolves every address and verifies all expected data without
+     * writing anything. Committing then writes every patch inside one protection
+     * window and journals the original bytes, so a failed commit leaves memory
+     * untouched and a committed transaction can be rolled back later.
+     * Patches take effect in the order of their order field, then in the
+     * order they were added.
+     */
+    class transaction
+    {
+    public:
+        explicit transaction(memory::backend& memory, cache::store* cache = nullptr);
+
+        auto add(std::uint8_t* base, const parser::patch& patch) -> void;
+        auto add(std::uint8_t* base, const parser::patch& patch, const plan::step& planned) -> void;
+        [[nodiscard]] auto prepare() -> bool;
+        [[nodiscard]] auto commit() -> bool;
+        auto rollback() -> bool;
+
+        [[nodiscard]] auto size() const -> std::size_t;
+        [[nodiscard]] auto failed() const -> const parser::patch*;
+        [[nodiscard]] auto changes() const -> const journal&;
+
+    private:
+        struct step
+        {
+            std::uint8_t* base;
+            const parser::patch* patch;
+            std::uint8_t* address;
+            bool planned;
+            bool verified;
+
+            // bytes to write for data with wildcards, set while preparing
+            std::size_t projection;
+        };
+
+        struct projection
+        {
+            std::uint8_t* address;
+            std::vector<std::uint8_t> bytes;
+        };
+
+        memory::backend* memory;
+        cache::store* resolved;
+        std::vector<step> steps;
+        std::vector<projection> projected;
+        std::multimap<std::uintptr_t, std::size_t> projected_at;
+        std::size_t longest {};
+        std::vector<pe::image> images;
+        std::vector<std::pair<std::uint8_t*, pe::export_index>> exports;
+        std::vector<std::pair<std::uint8_t*, pe::import_index>> imports;
+        std::vector<std::pair<std::uint8_t*, cache::key>> keys;
+        journal log;
+        const parser::patch* failure {};
+        bool prepared {};
+        bool committed {};
+
+        [[nodiscard]] auto image(std::uint8_t* base) -> const pe::image&;
+        [[nodiscard]] auto symbols(std::uint8_t* base) -> const pe::export_index&;
+        [[nodiscard]] auto slots(std::uint8_t* base) -> const pe::import_index&;
+        [[nodiscard]] auto cache_key(std::uint8_t* base) -> const cache::key&;
+        [[nodiscard]] auto find_export(std::uint8_t* base, std::string_view name) -> std::uint8_t*;
+        [[nodiscard]] auto lookup(std::uint8_t* base, const parser::patch& patch) -> std::uint8_t*;
+        [[nodiscard]] auto resolve(std::uint8_t* base, const parser::patch& patch) -> std::uint8_t*;
+        [[nodiscard]] auto verify(step& step) -> bool;
+        auto overlay(std::uint8_t* address, std::span<std::uint8_t> current) const -> void;
+        auto project(std::uint8_t* address, const parser::data& on, std::span<const std::uint8_t> current) -> std::size_t;
+        [[nodiscard]] auto touched(const std::uint8_t* address, std::size_t size) const -> bool;
+        auto restore() -> bool;
+    };
+
+    [[nodiscard]] auto matches(const std::uint8_t* current, const parser::patch& patch) -> bool;
+    [[nodiscard]] auto fits_slot(const parser::patch& patch, std::size_t width) -> bool;
+    [[nodiscard]] auto apply(std::uint8_t* base, const parser::patch& patch, memory::backend& memory) -> bool;
+    auto revert(memory::backend& memory, const journal& changes) -> bool;
+}
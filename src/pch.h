@@ -2,10 +2,13 @@
 
 // win32
 #include <windows.h>
+#include <tlhelp32.h>
 
 // win32 extras
 #include "ntdll.h"
 
 // vendor
-#include <spdlog/spdlog.h>
-#include <spdlog/sinks/basic_file_sink.h>
\ No newline at end of file
+#if !MEMPATCHER_LOG_MINIMAL
+    #include <spdlog/spdlog.h>
+    #include <spdlog/sinks/basic_file_sink.h>
+#endif
\ No newline at end of file
@@ -0,0 +1,507 @@
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+
+#include "pe.h"
+
+using namespace mempatcher;
+using namespace mempatcher::pe;
+
+namespace mempatcher::pe::detail
+{
+    auto constexpr dos_signature = std::uint16_t { 0x5A4D };
+    auto constexpr nt_signature = std::uint32_t { 0x00004550 };
+    auto constexpr pe32_magic = std::uint16_t { 0x10B };
+    auto constexpr pe32plus_magic = std::uint16_t { 0x20B };
+    auto constexpr section_header_size = std::size_t { 40 };
+    auto constexpr section_name_size = std::size_t { 8 };
+    auto constexpr import_descriptor_size = std::size_t { 20 };
+    auto constexpr relocation_block_header = std::size_t { 8 };
+    auto constexpr max_relocation_size = std::size_t { 8 };
+
+    /**
+     * Read an unaligned little-endian value from a buffer.
+     */
+    template <typename T>
+    auto read(const std::uint8_t* data, std::size_t size, std::size_t offset) -> std::optional<T>
+    {
+        if (offset > size || size - offset < sizeof(T))
+            return std::nullopt;
+
+        auto result = T {};
+        std::memcpy(&result, data + offset, sizeof(T));
+        return result;
+    }
+
+    /**
+     * Lowercase a library name for case-insensitive lookups.
+     */
+    auto lowercase(std::string_view name) -> std::string
+    {
+        auto result = std::string { name };
+
+        for (auto& c: result)
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+        return result;
+    }
+}
+
+/**
+ * Parse the headers of a PE image.
+ *
+ * @param data Pointer to the start of the image.
+ * @param size Size of the image in bytes.
+ * @param type Whether the image is laid out as mapped by the loader or as stored on disk.
+ */
+image::image(const std::uint8_t* data, std::size_t size, layout type):
+    base { data }, length { size }, type { type }
+{
+    using detail::read;
+
+    if (!base || read<std::uint16_t>(base, length, 0) != detail::dos_signature)
+        return;
+
+    nt_offset = read<std::uint32_t>(base, length, 0x3C).value_or(0);
+
+    if (read<std::uint32_t>(base, length, nt_offset) != detail::nt_signature)
+        return;
+
+    auto const count = read<std::uint16_t>(base, length, nt_offset + 6);
+    auto const optional_size = read<std::uint16_t>(base, length, nt_offset + 20);
+
+    optional_offset = nt_offset + 24;
+    magic = read<std::uint16_t>(base, length, optional_offset).value_or(0);
+
+    if (!count || !optional_size || (magic != detail::pe32_magic && magic != detail::pe32plus_magic))
+        return;
+
+    auto const first = std::size_t { optional_offset } + *optional_size;
+
+    for (auto i = std::size_t {}; i < *count; ++i)
+    {
+        auto const header = first + i * detail::section_header_size;
+
+        if (header > length || length - header < detail::section_header_size)
+            return;
+
+        auto const name = reinterpret_cast<const char*>(base + header);
+
+        table.push_back({
+            .name = { name, strnlen(name, detail::section_name_size) },
+            .virtual_address = *read<std::uint32_t>(base, length, header + 12),
+            .virtual_size = *read<std::uint32_t>(base, length, header + 8),
+            .raw_offset = *read<std::uint32_t>(base, length, header + 20),
+            .raw_size = *read<std::uint32_t>(base, length, header + 16),
+        });
+    }
+
+    ok = true;
+}
+
+/**
+ * Create a view of a module mapped by the loader, sized from its own headers.
+ *
+ * @param base Pointer to the image base address.
+ * @return View of the module. Invalid if the headers could not be parsed.
+ */
+auto image::from_module(const std::uint8_t* base) -> image
+{
+    // read the header with an unbounded view first to find the image size
+    auto const headers = image { base, SIZE_MAX };
+
+    if (!headers.valid())
+        return headers;
+
+    auto const size = detail::read<std::uint32_t>(base, SIZE_MAX, headers.optional_offset + 56);
+
+    return { base, size.value_or(0) };
+}
+
+auto image::valid() const -> bool
+    { return ok; }
+
+auto image::data() const -> const std::uint8_t*
+    { return base; }
+
+auto image::size() const -> std::size_t
+    { return length; }
+
+auto image::pointer_size() const -> std::size_t
+    { return magic == detail::pe32plus_magic ? 8: 4; }
+
+auto image::sections() const -> std::span<const section>
+    { return table; }
+
+/**
+ * Read the fields that identify this build of the image.
+ *
+ * @return Timestamp, SizeOfImage and CheckSum from the headers. Zero if unreadable.
+ */
+auto image::build() const -> build_id
+{
+    using detail::read;
+
+    if (!ok)
+        return {};
+
+    return {
+        .timestamp = read<std::uint32_t>(base, length, nt_offset + 8).value_or(0),
+        .image_size = read<std::uint32_t>(base, length, optional_offset + 56).value_or(0),
+        .checksum = read<std::uint32_t>(base, length, optional_offset + 64).value_or(0),
+    };
+}
+
+/**
+ * Find a section header by name.
+ *
+ * @param name Section name, e.g. ".text".
+ * @return Section header, or nullptr if the section was not found.
+ */
+auto image::find_section(std::string_view name) const -> const section*
+{
+    auto const it = std::ranges::find(table, name, &section::name);
+    return it != table.end() ? &*it: nullptr;
+}
+
+/**
+ * Find the location of a data directory.
+ *
+ * @param index Directory to find.
+ * @return Directory RVA and size, or nothing if the image does not have it.
+ */
+auto image::find_directory(directory index) const -> std::optional<data_directory>
+{
+    using detail::read;
+
+    auto const plus = magic == detail::pe32plus_magic;
+    auto const count = read<std::uint32_t>(base, length, optional_offset + (plus ? 108: 92));
+    auto const first = optional_offset + (plus ? 112: 96);
+    auto const i = static_cast<std::size_t>(index);
+
+    if (!ok || !count || i >= *count)
+        return std::nullopt;
+
+    auto const rva = read<std::uint32_t>(base, length, first + i * 8);
+    auto const size = read<std::uint32_t>(base, length, first + i * 8 + 4);
+
+    if (!rva || !size || *rva == 0 || *size == 0)
+        return std::nullopt;
+
+    return data_directory { .rva = *rva, .size = *size };
+}
+
+/**
+ * Converts a file offset to a relative virtual address.
+ *
+ * @param offset File offset to convert.
+ * @return Relative virtual address, or nothing if the offset was invalid.
+ */
+auto image::file2rva(std::uintptr_t offset) const -> std::optional<std::uintptr_t>
+{
+    if (!ok || table.empty())
+        return std::nullopt;
+
+    if (offset < table.front().raw_offset)
+        return offset;
+
+    for (auto&& section: table)
+        if (offset >= section.raw_offset && offset < section.raw_offset + section.raw_size)
+            return section.virtual_address + (offset - section.raw_offset);
+
+    return std::nullopt;
+}
+
+/**
+ * Converts a relative virtual address to a file offset.
+ *
+ * @param rva Relative virtual address to convert.
+ * @return File offset, or nothing if the address is not backed by file data.
+ */
+auto image::rva2file(std::uintptr_t rva) const -> std::optional<std::uintptr_t>
+{
+    if (!ok || table.empty())
+        return std::nullopt;
+
+    if (rva < table.front().virtual_address)
+        return rva < table.front().raw_offset ? std::optional { rva }: std::nullopt;
+
+    for (auto&& section: table)
+        if (rva >= section.virtual_address && rva < section.virtual_address + section.raw_size)
+            return section.raw_offset + (rva - section.virtual_address);
+
+    return std::nullopt;
+}
+
+/**
+ * Get a pointer to data at a relative virtual address.
+ *
+ * @param rva Relative virtual address of the data.
+ * @param size Number of bytes that must be readable.
+ * @return Pointer to the data, or nullptr if it lies outside the view.
+ */
+auto image::at(std::uintptr_t rva, std::size_t size) const -> const std::uint8_t*
+{
+    auto const offset = type == layout::file ? rva2file(rva): std::optional { rva };
+
+    if (!offset || *offset > length || length - *offset < size)
+        return nullptr;
+
+    return base + *offset;
+}
+
+/**
+ * Get a null-terminated string at a relative virtual address.
+ *
+ * @param rva Relative virtual address of the string.
+ * @return The string, or nothing if it is not terminated inside the view.
+ */
+auto image::string_at(std::uintptr_t rva) const -> std::optional<std::string_view>
+{
+    auto const text = at(rva);
+
+    if (!text)
+        return std::nullopt;
+
+    auto const limit = length - static_cast<std::size_t>(text - base);
+    auto const size = strnlen(reinterpret_cast<const char*>(text), limit);
+
+    if (size == limit)
+        return std::nullopt;
+
+    return std::string_view { reinterpret_cast<const char*>(text), size };
+}
+
+/**
+ * Index every named export of an image.
+ * Exports whose address points back into the export directory are forwarders.
+ *
+ * @param image Image to index. Malformed entries are skipped.
+ */
+export_index::export_index(const image& image)
+{
+    auto const exports = image.find_directory(directory::exports);
+    auto const header = exports ? image.at(exports->rva, 40): nullptr;
+
+    if (!header)
+        return;
+
+    auto const field = [&] (std::size_t offset)
+        { return *detail::read<std::uint32_t>(header, 40, offset); };
+
+    auto const function_count = field(20);
+    auto const name_count = field(24);
+    auto const functions = image.at(field(28), std::size_t { function_count } * 4);
+    auto const name_table = image.at(field(32), std::size_t { name_count } * 4);
+    auto const ordinals = image.at(field(36), std::size_t { name_count } * 2);
+
+    if (!functions || !name_table || !ordinals)
+        return;
+
+    names.reserve(name_count);
+
+    for (auto i = std::size_t {}; i < name_count; ++i)
+    {
+        auto const name_rva = *detail::read<std::uint32_t>(name_table, name_count * 4, i * 4);
+        auto const ordinal = *detail::read<std::uint16_t>(ordinals, name_count * 2, i * 2);
+        auto const name = image.string_at(name_rva);
+
+        if (!name || ordinal >= function_count)
+            continue;
+
+        auto entry = export_entry {
+            .rva = *detail::read<std::uint32_t>(functions, function_count * 4, ordinal * 4),
+            .forwarder = {},
+        };
+
+        if (entry.rva >= exports->rva && entry.rva < exports->rva + exports->size)
+            entry.forwarder = image.string_at(entry.rva).value_or("");
+
+        names.emplace(*name, entry);
+    }
+}
+
+/**
+ * Find an export by name.
+ *
+ * @param name Exported name, case sensitive.
+ * @return Export entry, or nullptr if the image does not export the name.
+ */
+auto export_index::find(std::string_view name) const -> const export_entry*
+{
+    auto const it = names.find(name);
+    return it != names.end() ? &it->second: nullptr;
+}
+
+auto export_index::size() const -> std::size_t
+    { return names.size(); }
+
+/**
+ * Index the named import slots of an image.
+ * Names are taken from the lookup table, since the loader overwrites the address table.
+ *
+ * Descriptors without a lookup table are skipped.
+ *
+ * @param image Image to index. Malformed descriptors and thunks are skipped.
+ */
+import_index::import_index(const image& image)
+{
+    auto const imports = image.find_directory(directory::imports);
+
+    if (!imports)
+        return;
+
+    auto const width = image.pointer_size();
+    auto const ordinal_flag = std::uint64_t { 1 } << (width * 8 - 1);
+    auto const end = std::size_t { imports->rva } + imports->size;
+
+    for (auto rva = std::size_t { imports->rva }; rva + detail::import_descriptor_size <= end; rva += detail::import_descriptor_size)
+    {
+        auto const descriptor = image.at(rva, detail::import_descriptor_size);
+
+        if (!descriptor)
+            break;
+
+        auto const field = [&] (std::size_t offset)
+            { return *detail::read<std::uint32_t>(descriptor, detail::import_descriptor_size, offset); };
+
+        auto const lookup = field(0);
+        auto const name = field(12);
+        auto const first = field(16);
+
+        if (name == 0 && first == 0)
+            break;
+
+        auto const library = image.string_at(name);
+
+        if (!library)
+            continue;
+
+        // without a lookup table the names are only in the address table, which
+        // holds pointers instead once the image is loaded or bound
+        if (lookup == 0)
+            continue;
+
+        auto& slots = libraries[detail::lowercase(*library)];
+
+        for (auto i = std::size_t {};; ++i)
+        {
+            auto const thunk = image.at(lookup + i * width, width);
+
+            if (!thunk)
+                break;
+
+            auto const value = width == 8 ? *detail::read<std::uint64_t>(thunk, width, 0):
+                                            *detail::read<std::uint32_t>(thunk, width, 0);
+
+            if (value == 0)
+                break;
+
+            if (value & ordinal_flag)
+                continue;
+
+            // skip the two byte hint in front of the name
+            auto const function = image.string_at(static_cast<std::uint32_t>(value) + 2);
+
+            if (function && slots.emplace(*function, first + i * width).second)
+                ++count;
+        }
+    }
+}
+
+/**
+ * Find the import address table slot of an imported function.
+ *
+ * @param library Name of the library the function is imported from, e.g. "kernel32.dll".
+ * @param name Imported function name, case sensitive.
+ * @return RVA of the slot, or nothing if the image does not import the function.
+ */
+auto import_index::find(std::string_view library, std::string_view name) const -> std::optional<std::uint32_t>
+{
+    auto const slots = libraries.find(detail::lowercase(library));
+
+    if (slots == libraries.end())
+        return std::nullopt;
+
+    auto const it = slots->second.find(name);
+    return it != slots->second.end() ? std::optional { it->second }: std::nullopt;
+}
+
+auto import_index::size() const -> std::size_t
+    { return count; }
+
+/**
+ * Collect every relocated field of an image.
+ *
+ * @param image Image to index. Malformed blocks end the walk.
+ */
+relocation_index::relocation_index(const image& image)
+{
+    auto const relocations = image.find_directory(directory::relocations);
+
+    if (!relocations)
+        return;
+
+    auto const end = std::size_t { relocations->rva } + relocations->size;
+
+    for (auto rva = std::size_t { relocations->rva }; rva + detail::relocation_block_header <= end;)
+    {
+        auto const header = image.at(rva, detail::relocation_block_header);
+
+        if (!header)
+            break;
+
+        auto const page = *detail::read<std::uint32_t>(header, detail::relocation_block_header, 0);
+        auto const size = *detail::read<std::uint32_t>(header, detail::relocation_block_header, 4);
+
+        if (size < detail::relocation_block_header || rva + size > end)
+            break;
+
+        auto const entries = image.at(rva, size);
+
+        if (!entries)
+            break;
+
+        for (auto offset = detail::relocation_block_header; offset + 2 <= size; offset += 2)
+        {
+            auto const entry = *detail::read<std::uint16_t>(entries, size, offset);
+
+            // IMAGE_REL_BASED_ABSOLUTE is padding, HIGH and LOW touch 2 bytes, DIR64 touches 8
+            switch (entry >> 12)
+            {
+                case 0:  continue;
+                case 1:
+                case 2:  fields.push_back({ .rva = page + (entry & 0xFFF), .size = 2 }); break;
+                case 10: fields.push_back({ .rva = page + (entry & 0xFFF), .size = 8 }); break;
+                default: fields.push_back({ .rva = page + (entry & 0xFFF), .size = 4 }); break;
+            }
+        }
+
+        rva += size;
+    }
+
+    std::ranges::sort(fields, {}, &field::rva);
+}
+
+/**
+ * Check whether any relocated field overlaps a range.
+ *
+ * @param rva Start of the range.
+ * @param size Size of the range in bytes.
+ * @return True if the loader may change any byte of the range, false otherwise.
+ */
+auto relocation_index::intersects(std::uintptr_t rva, std::size_t size) const -> bool
+{
+    // fields are at most 8 bytes, so only those starting shortly before the range can reach into it
+    auto const first = rva < detail::max_relocation_size ? 0: rva - detail::max_relocation_size + 1;
+    auto it = std::ranges::lower_bound(fields, first, {}, &field::rva);
+
+    for (; it != fields.end() && it->rva < rva + size; ++it)
+        if (it->rva + it->size > rva)
+            return true;
+
+    return false;
+}
+
+auto relocation_index::size() const -> std::size_t
+    { return fields.size(); }
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+
+namespace mempatcher::pe
+{
+    enum class layout { mapped, file };
+
+    enum class directory: std::size_t
+    {
+        exports = 0,
+        imports = 1,
+        relocations = 5,
+    };
+
+    struct section
+    {
+        std::string_view name;
+        std::uint32_t virtual_address;
+        std::uint32_t virtual_size;
+        std::uint32_t raw_offset;
+        std::uint32_t raw_size;
+    };
+
+    struct data_directory
+    {
+        std::uint32_t rva;
+        std::uint32_t size;
+    };
+
+    /**
+     * Header fields that change with every build of a module.
+     */
+    struct build_id
+    {
+        std::uint32_t timestamp;
+        std::uint32_t image_size;
+        std::uint32_t checksum;
+
+        auto operator==(const build_id&) const -> bool = default;
+    };
+
+    /**
+     * Read-only view of a PE image, either mapped by the loader or as stored on disk.
+     *
+     * Every read is bounds checked against the size of the view, so malformed
+     * images produce empty results instead of out of bounds accesses.
+     */
+    class image
+    {
+    public:
+        image(const std::uint8_t* data, std::size_t size, layout type = layout::mapped);
+
+        [[nodiscard]] static auto from_module(const std::uint8_t* base) -> image;
+
+        [[nodiscard]] auto valid() const -> bool;
+        [[nodiscard]] auto data() const -> const std::uint8_t*;
+        [[nodiscard]] auto size() const -> std::size_t;
+        [[nodiscard]] auto pointer_size() const -> std::size_t;
+        [[nodiscard]] auto build() const -> build_id;
+        [[nodiscard]] auto sections() const -> std::span<const section>;
+        [[nodiscard]] auto find_section(std::string_view name) const -> const section*;
+        [[nodiscard]] auto find_directory(directory index) const -> std::optional<data_directory>;
+        [[nodiscard]] auto file2rva(std::uintptr_t offset) const -> std::optional<std::uintptr_t>;
+        [[nodiscard]] auto rva2file(std::uintptr_t rva) const -> std::optional<std::uintptr_t>;
+        [[nodiscard]] auto at(std::uintptr_t rva, std::size_t size = 1) const -> const std::uint8_t*;
+        [[nodiscard]] auto string_at(std::uintptr_t rva) const -> std::optional<std::string_view>;
+
+    private:
+        const std::uint8_t* base;
+        std::size_t length;
+        layout type;
+        bool ok {};
+        std::uint32_t nt_offset {};
+        std::uint32_t optional_offset {};
+        std::uint16_t magic {};
+        std::vector<section> table;
+    };
+
+    struct export_entry
+    {
+        std::uint32_t rva;
+        std::string_view forwarder;
+    };
+
+    /**
+     * Hash index of the named exports of an image.
+     *
+     * Built once per module, so resolving many exported names costs one
+     * walk of the export directory instead of a binary search per name.
+     * Names and forwarders point into the image and share its lifetime.
+     */
+    class export_index
+    {
+    public:
+        explicit export_index(const image& image);
+
+        [[nodiscard]] auto find(std::string_view name) const -> const export_entry*;
+        [[nodiscard]] auto size() const -> std::size_t;
+
+    private:
+        std::unordered_map<std::string_view, export_entry> names;
+    };
+
+    /**
+     * Hash index of the import address table slots of an image, by library and name.
+     *
+     * Library names are matched case-insensitively like the loader does.
+     * Imports by ordinal have no name and are not indexed.
+     */
+    class import_index
+    {
+    public:
+        explicit import_index(const image& image);
+
+        [[nodiscard]] auto find(std::string_view library, std::string_view name) const -> std::optional<std::uint32_t>;
+        [[nodiscard]] auto size() const -> std::size_t;
+
+    private:
+        std::unordered_map<std::string, std::unordered_map<std::string_view, std::uint32_t>> libraries;
+        std::size_t count {};
+    };
+
+    /**
+     * Sorted list of the fields the loader rewrites when the image is not loaded at its preferred base.
+     *
+     * Bytes inside these fields differ between the file on disk and the mapped
+     * image, so they cannot be verified ahead of loading.
+     */
+    class relocation_index
+    {
+    public:
+        explicit relocation_index(const image& image);
+
+        [[nodiscard]] auto intersects(std::uintptr_t rva, std::size_t size) const -> bool;
+        [[nodiscard]] auto size() const -> std::size_t;
+
+    private:
+        struct field
+        {
+            std::uint32_t rva;
+            std::uint8_t size;
+        };
+
+        std::vector<field> fields;
+    };
+}
@@ -0,0 +1,130 @@
+#include <algorithm>
+
+#include "plan.h"
+#include "patch.h"
+
+using namespace mempatcher;
+using namespace mempatcher::plan;
+
+namespace mempatcher::plan::detail
+{
+    /**
+     * Work out the RVA of a patch from the file alone, without anything the loader does.
+     *
+     * @param file Image as stored on disk.
+     * @param exports Export index of the file.
+     * @param imports Import index of the file.
+     * @param patch Patch to resolve.
+     * @return RVA of the patch, or nothing if it can only be resolved after loading.
+     */
+    auto resolve(const pe::image& file, const pe::export_index& exports,
+        const pe::import_index& imports, const parser::patch& patch) -> std::optional<std::uintptr_t>
+    {
+        switch (patch.type)
+        {
+            case parser::addr_type::rva:
+                return patch.address;
+            case parser::addr_type::file:
+                return file.file2rva(patch.address);
+            case parser::addr_type::symbol:
+            {
+                // forwarders lead into other modules, which may not be loaded yet
+                auto const entry = exports.find(patch.symbol);
+                return entry && entry->forwarder.empty() ? std::optional { entry->rva + patch.address }: std::nullopt;
+            }
+            case parser::addr_type::iat:
+            {
+                if (!patch::fits_slot(patch, file.pointer_size()))
+                    return std::nullopt;
+
+                auto const slot = imports.find(patch.library, patch.symbol);
+                return slot ? std::optional<std::uintptr_t> { *slot }: std::nullopt;
+            }
+            default:
+                return std::nullopt;
+        }
+    }
+
+    /**
+     * Get the bytes of a range from the file, if they are stored contiguously in it.
+     *
+     * @param file Image as stored on disk.
+     * @param rva Start of the range.
+     * @param size Size of the range in bytes.
+     * @return Pointer to the bytes, or nullptr if part of the range has no file data.
+     */
+    auto file_bytes(const pe::image& file, std::uintptr_t rva, std::size_t size) -> const std::uint8_t*
+    {
+        auto const first = file.rva2file(rva);
+        auto const last = file.rva2file(rva + size - 1);
+
+        // uninitialised data and ranges spilling past a section's raw data are only known after loading
+        if (!first || !last || *last - *first != size - 1)
+            return nullptr;
+
+        return file.at(rva, size);
+    }
+}
+
+/**
+ * Prepare an apply plan for the patches of a module from its file on disk.
+ *
+ * Resolves every address that does not depend on other modules and verifies
+ * expected bytes that the loader will not change. Import slots are never
+ * verified, since binding overwrites them, and neither are bytes that an
+ * earlier patch writes, which the transaction compares after projecting it.
+ *
+ * @param file Image as stored on disk.
+ * @param patches Patches for the module.
+ * @return Plan with one entry per patch.
+ */
+auto plan::prepare(const pe::image& file, std::span<const parser::patch> patches) -> module_plan
+{
+    auto result = module_plan { .build = file.build(), .steps = {}, .path = {} };
+    auto const image_size = std::size_t { result.build.image_size };
+    result.steps.reserve(patches.size());
+
+    auto const exports = pe::export_index { file };
+    auto const imports = pe::import_index { file };
+    auto const relocations = pe::relocation_index { file };
+
+    // ranges written by earlier steps, whose bytes in the file are stale by then
+    auto written = std::vector<std::pair<std::uintptr_t, std::size_t>> {};
+
+    auto const overwritten = [&] (std::uintptr_t rva, std::size_t size)
+    {
+        return std::ranges::any_of(written, [&] (auto&& range)
+            { return range.first < rva + size && rva < range.first + range.second; });
+    };
+
+    for (auto&& patch: patches)
+    {
+        auto& step = result.steps.emplace_back();
+        auto const size = std::max(patch.on.size(), patch.off.size());
+        auto const rva = file.valid() && !patch.crc ? detail::resolve(file, exports, imports, patch): std::nullopt;
+
+        if (!rva || *rva > image_size || image_size - *rva < size)
+            continue;
+
+        step = plan::step { .rva = static_cast<std::uint32_t>(*rva), .verified = false };
+
+        auto const stale = overwritten(*rva, size);
+
+        if (!patch.on.empty())
+            written.emplace_back(*rva, patch.on.size());
+
+        if (stale || patch.type == parser::addr_type::iat || relocations.intersects(*rva, size))
+            continue;
+
+        if (patch.off.empty())
+        {
+            step->verified = true;
+            continue;
+        }
+
+        auto const current = detail::file_bytes(file, *rva, size);
+        step->verified = current && patch::matches(current, patch);
+    }
+
+    return result;
+}
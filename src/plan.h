@@ -0,0 +1,42 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+
+#include "pe.h"
+#include "parser.h"
+
+namespace mempatcher::plan
+{
+    /**
+     * Where one patch goes, worked out from the module file before it was loaded.
+     */
+    struct step
+    {
+        std::uint32_t rva;
+
+        // expected bytes matched the file and no relocation touches them
+        bool verified;
+    };
+
+    /**
+     * Apply plan for the patches of one module, valid only for the exact build it was made from.
+     *
+     * Holds one entry per patch, in the same order. Patches that cannot be
+     * planned from the file, e.g. checksum checks or forwarded exports, are
+     * left empty and resolved when the module loads as usual.
+     */
+    struct module_plan
+    {
+        pe::build_id build;
+        std::vector<std::optional<step>> steps;
+
+        // file the plan was made from, set by the caller; another copy with the same build may differ
+        std::filesystem::path path;
+    };
+
+    [[nodiscard]] auto prepare(const pe::image& file, std::span<const parser::patch> patches) -> module_plan;
+}
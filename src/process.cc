@@ -0,0 +1,156 @@
+#include <filesystem>
+
+#include <windows.h>
+
+#include "atomic.h"
+#include "process.h"
+#include "checksum.h"
+
+using namespace mempatcher;
+using namespace mempatcher::memory;
+
+/**
+ * Copy memory while handling SEH exceptions.
+ *
+ * @param target Destination address.
+ * @param source Source address.
+ * @param size Number of bytes to copy.
+ * @return True if the copy succeeded, false otherwise.
+ */
+auto try_copy(void* target, const void* source, std::size_t size)
+{
+    __try
+        { std::memcpy(target, source, size); }
+    __except (EXCEPTION_EXECUTE_HANDLER)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Write memory with the smallest tear-free store while handling SEH exceptions.
+ *
+ * @param target Destination address.
+ * @param data Bytes to write.
+ * @return True if the write succeeded, false otherwise.
+ */
+auto try_write(std::uint8_t* target, std::span<const std::uint8_t> data)
+{
+    __try
+        { atomic::write(target, data); }
+    __except (EXCEPTION_EXECUTE_HANDLER)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Fill memory while handling SEH exceptions.
+ *
+ * @param target Destination address.
+ * @param value Byte to fill with.
+ * @param count Number of bytes to fill.
+ * @return True if the fill succeeded, false otherwise.
+ */
+auto try_fill(void* target, std::uint8_t value, std::size_t count)
+{
+    __try
+        { std::memset(target, value, count); }
+    __except (EXCEPTION_EXECUTE_HANDLER)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Calculate the checksum of a memory region while handling SEH exceptions.
+ *
+ * @param target Pointer to the memory location.
+ * @param size Size of the region in bytes.
+ * @param result Receives the checksum.
+ * @return True if the region was readable, false otherwise.
+ */
+auto try_checksum(const std::uint8_t* target, std::size_t size, std::uint32_t& result)
+{
+    __try
+        { result = checksum::crc32c({ target, size }); }
+    __except (EXCEPTION_EXECUTE_HANDLER)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+auto process::read(const std::uint8_t* address, std::span<std::uint8_t> out) -> bool
+    { return try_copy(out.data(), address, out.size()); }
+
+auto process::write(std::uint8_t* address, std::span<const std::uint8_t> data) -> bool
+    { return try_write(address, data); }
+
+auto process::fill(std::uint8_t* address, std::uint8_t value, std::size_t count) -> bool
+    { return try_fill(address, value, count); }
+
+auto process::checksum(const std::uint8_t* address, std::size_t size) -> std::optional<std::uint32_t>
+{
+    auto result = std::uint32_t {};
+
+    if (!try_checksum(address, size, result))
+        return std::nullopt;
+
+    return result;
+}
+
+auto process::unprotect(std::uint8_t* page) -> std::optional<std::uint32_t>
+{
+    auto old = DWORD {};
+
+    if (!VirtualProtect(page, 1, PAGE_EXECUTE_READWRITE, &old))
+        return std::nullopt;
+
+    return old;
+}
+
+auto process::protect(std::uint8_t* page, std::uint32_t protection) -> bool
+{
+    auto old = DWORD {};
+    return VirtualProtect(page, 1, protection, &old) != FALSE;
+}
+
+auto process::page_size() const -> std::size_t
+{
+    auto static const size = [] ()
+    {
+        auto info = SYSTEM_INFO {};
+        GetSystemInfo(&info);
+        return static_cast<std::size_t>(info.dwPageSize);
+    } ();
+
+    return size;
+}
+
+auto process::module(std::string_view name) -> std::uint8_t*
+{
+    return reinterpret_cast<std::uint8_t*>
+        (GetModuleHandleA(std::string { name }.c_str()));
+}
+
+auto process::module_name(const std::uint8_t* base) -> std::string
+{
+    auto path = std::wstring(MAX_PATH, L'\0');
+    auto const size = GetModuleFileNameW(reinterpret_cast<HMODULE>(const_cast<std::uint8_t*>(base)),
+        path.data(), static_cast<DWORD>(path.size()));
+
+    if (size == 0 || size == path.size())
+        return {};
+
+    path.resize(size);
+
+    return std::filesystem::path { path }.filename().string();
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "memory.h"
+
+namespace mempatcher::memory
+{
+    /**
+     * Backend for memory of the current process.
+     *
+     * Reads and writes are guarded with SEH, so invalid addresses fail
+     * instead of crashing the process.
+     */
+    class process final: public backend
+    {
+    public:
+        auto read(const std::uint8_t* address, std::span<std::uint8_t> out) -> bool override;
+        auto write(std::uint8_t* address, std::span<const std::uint8_t> data) -> bool override;
+        auto fill(std::uint8_t* address, std::uint8_t value, std::size_t count) -> bool override;
+        auto checksum(const std::uint8_t* address, std::size_t size) -> std::optional<std::uint32_t> override;
+        auto unprotect(std::uint8_t* page) -> std::optional<std::uint32_t> override;
+        auto protect(std::uint8_t* page, std::uint32_t protection) -> bool override;
+        auto page_size() const -> std::size_t override;
+        auto module(std::string_view name) -> std::uint8_t* override;
+        auto module_name(const std::uint8_t* base) -> std::string override;
+    };
+}
@@ -0,0 +1,75 @@
+#include <bit>
+#include <utility>
+#include <algorithm>
+
+#include "retry.h"
+
+using namespace mempatcher;
+using namespace mempatcher::retry;
+
+/**
+ * Schedule a timer to expire after a number of ticks.
+ *
+ * @param id Caller defined identifier, handed back once the timer expires.
+ * @param delay Ticks until expiry. Zero is treated as one, anything beyond max_delay is clamped.
+ */
+auto timer_wheel::schedule(std::size_t id, std::uint64_t delay) -> void
+{
+    place({ .id = id, .expiry = current + std::clamp<std::uint64_t>(delay, 1, max_delay) });
+    ++count;
+}
+
+/**
+ * Put a timer into the slot of the highest level where its expiry differs from the current tick.
+ *
+ * @param timer Timer to place.
+ */
+auto timer_wheel::place(const timer& timer) -> void
+{
+    // timers moved down on the tick they expire on have no distance left and go to level 0
+    auto const distance = (timer.expiry ^ current) | 1;
+    auto const level = std::min<std::size_t>((std::bit_width(distance) - 1) / slot_bits, levels - 1);
+    auto const slot = (timer.expiry >> (slot_bits * level)) & (slots - 1);
+
+    wheels[level][slot].push_back(timer);
+}
+
+/**
+ * Move time forward by one tick and collect every timer that expires on it.
+ *
+ * @param expired Receives the identifiers of expired timers.
+ */
+auto timer_wheel::advance(std::vector<std::size_t>& expired) -> void
+{
+    ++current;
+
+    // crossing into a new span of a higher level moves its timers down
+    for (auto level = std::size_t { 1 }; level < levels; ++level)
+    {
+        if ((current & ((std::uint64_t { 1 } << (slot_bits * level)) - 1)) != 0)
+            break;
+
+        auto& slot = wheels[level][(current >> (slot_bits * level)) & (slots - 1)];
+        auto const timers = std::exchange(slot, {});
+
+        for (auto&& timer: timers)
+            place(timer);
+    }
+
+    auto& due = wheels[0][current & (slots - 1)];
+
+    for (auto&& timer: due)
+        expired.push_back(timer.id);
+
+    count -= due.size();
+    due.clear();
+}
+
+auto timer_wheel::now() const -> std::uint64_t
+    { return current; }
+
+auto timer_wheel::size() const -> std::size_t
+    { return count; }
+
+auto timer_wheel::empty() const -> bool
+    { return count == 0; }
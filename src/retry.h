@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace mempatcher::retry
+{
+    /**
+     * Hierarchical timer wheel counting in abstract ticks.
+     *
+     * Each level has 64 slots, and every level covers 64 times the span of the
+     * one below it. Timers are placed in the level matching how far away they
+     * expire and moved down a level at most once per level as time advances, so
+     * scheduling is O(1) and servicing is amortised O(1) per timer.
+     */
+    class timer_wheel
+    {
+    public:
+        static auto constexpr slot_bits = 6u;
+        static auto constexpr slots = std::size_t { 1 } << slot_bits;
+        static auto constexpr levels = std::size_t { 4 };
+        static auto constexpr max_delay = (std::uint64_t { 1 } << (slot_bits * levels)) - 1;
+
+        auto schedule(std::size_t id, std::uint64_t delay) -> void;
+        auto advance(std::vector<std::size_t>& expired) -> void;
+
+        [[nodiscard]] auto now() const -> std::uint64_t;
+        [[nodiscard]] auto size() const -> std::size_t;
+        [[nodiscard]] auto empty() const -> bool;
+
+    private:
+        struct timer
+        {
+            std::size_t id;
+            std::uint64_t expiry;
+        };
+
+        std::array<std::array<std::vector<timer>, slots>, levels> wheels;
+        std::uint64_t current {};
+        std::size_t count {};
+
+        auto place(const timer& timer) -> void;
+    };
+}
@@ -1,3 +1,4 @@
+#include "pe.h"
 #include "util.h"
 
 using namespace mempatcher;
@@ -44,6 +45,74 @@ auto util::get_argv() -> std::vector<std::string>
     return result;
 }
 
+/**
+ * Get the names and base addresses of all modules loaded in the process.
+ *
+ * @return A vector of module names and base addresses.
+ */
+auto util::get_modules() -> std::vector<std::pair<std::string, std::uint8_t*>>
+{
+    auto const snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE, GetCurrentProcessId());
+
+    if (snapshot == INVALID_HANDLE_VALUE)
+    {
+        return {};
+    }
+
+    auto result = std::vector<std::pair<std::string, std::uint8_t*>> {};
+    auto entry = MODULEENTRY32W { .dwSize = sizeof(MODULEENTRY32W) };
+
+    for (auto ok = Module32FirstW(snapshot, &entry); ok; ok = Module32NextW(snapshot, &entry))
+        result.emplace_back(narrow(entry.szModule), entry.modBaseAddr);
+
+    CloseHandle(snapshot);
+
+    return result;
+}
+
+/**
+ * Find the address of an export, following forwarders through the export
+ * directories of modules that are already loaded.
+ *
+ * GetProcAddress is not used, since it can take the loader lock. Forwarders to
+ * modules that are not loaded, to API sets or by ordinal are not resolved.
+ *
+ * @param base Pointer to the image base address of the exporting module.
+ * @param name The name of the export.
+ * @return Address of the export, or nullptr if it could not be resolved.
+ */
+auto find_export(std::uint8_t* base, std::string_view name) -> std::uint8_t*
+{
+    // forwarder chains are short in practice, anything longer is likely a cycle
+    auto constexpr max_depth = 8;
+
+    for (auto depth = 0; base && depth < max_depth; ++depth)
+    {
+        auto const exports = pe::export_index { pe::image::from_module(base) };
+        auto const entry = exports.find(name);
+
+        if (!entry)
+            return nullptr;
+
+        if (entry->forwarder.empty())
+            return base + entry->rva;
+
+        // forwarders look like "NTDLL.RtlAllocateHeap"
+        auto const dot = entry->forwarder.rfind('.');
+
+        if (dot == std::string_view::npos || dot + 1 == entry->forwarder.size() || entry->forwarder[dot + 1] == '#')
+            return nullptr;
+
+        auto const module = std::string { entry->forwarder.substr(0, dot) };
+
+        // the name points into the image, which stays loaded
+        name = entry->forwarder.substr(dot + 1);
+        base = reinterpret_cast<std::uint8_t*>(GetModuleHandleA(module.c_str()));
+    }
+
+    return nullptr;
+}
+
 /**
  * Find addresses to exported methods from a loaded module.
  *
@@ -61,12 +130,12 @@ auto util::resolve_dll_imports(std::string_view module, const std::vector<std::s
         return {};
     }
 
+    auto const base = reinterpret_cast<std::uint8_t*>(handle);
     auto result = std::unordered_map<std::string, std::uint8_t*> {};
 
     for (auto&& name: names)
     {
-        result[name] = reinterpret_cast<std::uint8_t*>
-            (GetProcAddress(handle, name.c_str()));
+        result[name] = find_export(base, name);
 
         if (!result[name])
         {
@@ -75,4 +144,25 @@ auto util::resolve_dll_imports(std::string_view module, const std::vector<std::s
     }
 
     return result;
-}
\ No newline at end of file
+}
+
+/**
+ * Find the file a library name would most likely be loaded from, following the DLL search path.
+ *
+ * @param name Library name, e.g. "bm2dx.dll".
+ * @return Full path to the file, or nothing if it was not found.
+ */
+auto util::find_library(const std::string& name) -> std::optional<std::filesystem::path>
+{
+    auto const wide = std::filesystem::path { name }.wstring();
+    auto path = std::wstring(MAX_PATH, L'\0');
+    auto const size = SearchPathW(nullptr, wide.c_str(), nullptr,
+        static_cast<DWORD>(path.size()), path.data(), nullptr);
+
+    if (size == 0 || size >= path.size())
+        return std::nullopt;
+
+    path.resize(size);
+
+    return std::filesystem::path { path };
+}
@@ -1,9 +1,17 @@
 #pragma once
 
+#include <string>
+#include <vector>
+#include <optional>
+#include <unordered_map>
+#include <filesystem>
+
 namespace mempatcher::util
 {
     [[nodiscard]] auto narrow(const std::wstring& input) -> std::string;
     [[nodiscard]] auto get_argv() -> std::vector<std::string>;
+    [[nodiscard]] auto get_modules() -> std::vector<std::pair<std::string, std::uint8_t*>>;
     [[nodiscard]] auto resolve_dll_imports(std::string_view module, const std::vector<std::string>& names)
         -> std::unordered_map<std::string, std::uint8_t*>;
+    [[nodiscard]] auto find_library(const std::string& name) -> std::optional<std::filesystem::path>;
 }
\ No newline at end of file
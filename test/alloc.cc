@@ -0,0 +1,176 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <format>
+#include <fstream>
+#include <filesystem>
+
+#include "heap.h"
+#include "../src/alloc.h"
+#include "../src/parser.h"
+
+using namespace mempatcher;
+
+namespace
+{
+    /**
+     * Build patch file contents with a number of lines for the same target.
+     */
+    auto make_patch_text(std::size_t lines)
+    {
+        auto result = std::string {};
+
+        for (auto i = std::size_t {}; i < lines; ++i)
+            result += std::format("target.dll {:X} 9090 7407\n", 0x1000 + i * 0x10);
+
+        return result;
+    }
+}
+
+TEST_CASE("Counting resource tracks allocations", "[alloc]")
+{
+    auto resource = alloc::counting_resource {};
+
+    {
+        auto values = std::pmr::vector<std::uint32_t> { &resource };
+        values.reserve(16);
+
+        auto more = std::pmr::vector<std::uint32_t> { &resource };
+        more.reserve(8);
+
+        REQUIRE(resource.live() == 24 * sizeof(std::uint32_t));
+    }
+
+    auto const total = resource.total();
+
+    REQUIRE(total.count == 2);
+    REQUIRE(total.bytes == 24 * sizeof(std::uint32_t));
+    REQUIRE(total.peak == 24 * sizeof(std::uint32_t));
+    REQUIRE(resource.live() == 0);
+
+    resource.reset();
+
+    REQUIRE(resource.total().count == 0);
+    REQUIRE(resource.total().peak == 0);
+}
+
+TEST_CASE("Phases record their own usage", "[alloc]")
+{
+    auto resource = alloc::counting_resource {};
+    auto kept = std::pmr::vector<std::uint8_t> { &resource };
+
+    {
+        auto const outer = alloc::phase { resource, "outer" };
+        kept.reserve(100);
+
+        {
+            auto const inner = alloc::phase { resource, "inner" };
+            auto temporary = std::pmr::vector<std::uint8_t> { &resource };
+            temporary.reserve(50);
+        }
+
+        REQUIRE(outer.used().count == 2);
+    }
+
+    {
+        auto const later = alloc::phase { resource, "later" };
+        auto temporary = std::pmr::vector<std::uint8_t> { &resource };
+        temporary.reserve(10);
+    }
+
+    auto const phases = resource.phases();
+
+    REQUIRE(phases.size() == 3);
+
+    REQUIRE(phases[0].name == "inner");
+    REQUIRE(phases[0].used.count == 1);
+    REQUIRE(phases[0].used.bytes == 50);
+    REQUIRE(phases[0].used.peak == 150);
+
+    REQUIRE(phases[1].name == "outer");
+    REQUIRE(phases[1].used.count == 2);
+    REQUIRE(phases[1].used.bytes == 150);
+    REQUIRE(phases[1].used.peak == 150);
+
+    // the peak includes what earlier phases left allocated
+    REQUIRE(phases[2].name == "later");
+    REQUIRE(phases[2].used.bytes == 10);
+    REQUIRE(phases[2].used.peak == 110);
+
+    {
+        auto discarded = alloc::phase { resource, "discarded" };
+        discarded.discard();
+    }
+
+    REQUIRE(resource.phases().size() == 3);
+}
+
+TEST_CASE("Parsing allocates patch lists from the given resource", "[alloc]")
+{
+    auto resource = alloc::counting_resource {};
+    auto const text = make_patch_text(1000);
+
+    {
+        auto const phase = alloc::phase { resource, "parse" };
+        auto const patches = parser::read_buffer(text, "buffer", &resource);
+
+        REQUIRE(patches.has_value());
+        REQUIRE(patches->size() == 1000);
+        REQUIRE(patches->get_allocator().resource() == &resource);
+        REQUIRE(resource.live() >= 1000 * sizeof(parser::patch));
+
+        // the bytes of each patch come from the same resource as the list
+        REQUIRE((*patches)[0].on.bytes.get_allocator().resource() == &resource);
+        REQUIRE((*patches)[0].off.bytes.get_allocator().resource() == &resource);
+        REQUIRE((*patches)[0].target.get_allocator().resource() == &resource);
+
+        // one buffer each for the on and off bytes, and the list only grows geometrically,
+        // it is never copied into a second one
+        REQUIRE(phase.used().count <= 2 * 1000 + 12);
+        REQUIRE(phase.used().peak <= 3 * 1024 * sizeof(parser::patch) + 1000 * 2 * 2);
+    }
+
+    REQUIRE(resource.live() == 0);
+}
+
+TEST_CASE("Parsing stays within an allocation budget per line", "[alloc]")
+{
+    auto const lines = std::size_t { 1000 };
+    auto const text = make_patch_text(lines);
+
+    // counts everything, including the strings and byte vectors inside each patch
+    auto const before = test::heap::allocated();
+    auto const patches = parser::read_buffer(text, "buffer");
+    auto const after = test::heap::allocated();
+
+    REQUIRE(patches.has_value());
+    REQUIRE(patches->size() == lines);
+
+    // a handful of small buffers per patch, plus the list growing geometrically
+    REQUIRE(after.count - before.count <= 8 * lines);
+    REQUIRE(after.bytes - before.bytes <= 2048 * lines);
+}
+
+TEST_CASE("Chunks are allocated from the given resource", "[alloc]")
+{
+    {
+        auto file = std::ofstream { "alloc.mph" };
+        file << make_patch_text(100);
+    }
+
+    auto resource = alloc::counting_resource {};
+    auto chunks = std::size_t {};
+
+    auto const read = parser::read_file("alloc.mph", [&] (auto&& chunk)
+    {
+        ++chunks;
+        return chunk.get_allocator().resource() == &resource;
+    }, 32, &resource);
+
+    REQUIRE(read.has_value());
+    REQUIRE(*read == 100);
+    REQUIRE(chunks == 4);
+    REQUIRE(resource.live() == 0);
+    REQUIRE(resource.total().count >= chunks);
+
+    std::filesystem::remove("alloc.mph");
+}
@@ -0,0 +1,50 @@
+#include <array>
+#include <numeric>
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/atomic.h"
+
+using namespace mempatcher;
+
+TEST_CASE("Atomic writes replace only the target bytes", "[atomic]")
+{
+    for (auto size = std::size_t { 1 }; size <= 24; ++size)
+    {
+        for (auto offset = std::size_t {}; offset < 32; ++offset)
+        {
+            alignas(64) auto memory = std::array<std::uint8_t, 64> {};
+            auto data = std::vector<std::uint8_t>(size);
+
+            std::iota(memory.begin(), memory.end(), std::uint8_t { 0x80 });
+            std::iota(data.begin(), data.end(), std::uint8_t { 0x01 });
+
+            auto expected = memory;
+            std::ranges::copy(data, expected.begin() + offset);
+
+            atomic::write(memory.data() + offset, data);
+
+            REQUIRE(memory == expected);
+        }
+    }
+}
+
+TEST_CASE("Contained writes use a single atomic store", "[atomic]")
+{
+    alignas(64) auto memory = std::array<std::uint8_t, 64> {};
+    auto const data = std::array<std::uint8_t, 17> {};
+
+    REQUIRE(atomic::store(memory.data(), { data.data(), 1 }));
+    REQUIRE(atomic::store(memory.data() + 2, { data.data(), 2 }));
+    REQUIRE(atomic::store(memory.data() + 3, { data.data(), 5 }));
+    REQUIRE(atomic::store(memory.data() + 8, { data.data(), 8 }));
+
+    REQUIRE(atomic::fits(memory.data() + 7, 1));
+    REQUIRE(atomic::fits(memory.data() + 4, 4));
+    REQUIRE(!atomic::fits(memory.data() + 15, 2));
+    REQUIRE(!atomic::fits(memory.data(), 17));
+
+    // crosses both an 8 and a 16-byte boundary
+    REQUIRE(!atomic::store(memory.data() + 15, { data.data(), 2 }));
+    REQUIRE(!atomic::store(memory.data(), { data.data(), 17 }));
+}
@@ -0,0 +1,116 @@
+#include <fstream>
+#include <catch2/catch_test_macros.hpp>
+
+#include "image.h"
+#include "../src/cache.h"
+#include "../src/patch.h"
+
+using namespace mempatcher;
+using test::parse;
+
+namespace
+{
+    auto const build = pe::build_id { .timestamp = 0x12345678, .image_size = 0x4000, .checksum = 0xC0FFEE };
+}
+
+TEST_CASE("Patch hashes change with the patch contents", "[cache]")
+{
+    auto const base = cache::hash(parse("test.dll F+400 9090 7407"));
+
+    REQUIRE(base == cache::hash(parse("test.dll F+400 9090 7407")));
+    REQUIRE(base != cache::hash(parse("test.dll F+401 9090 7407")));
+    REQUIRE(base != cache::hash(parse("test.dll 400 9090 7407")));
+    REQUIRE(base != cache::hash(parse("test.dll F+400 9090 7408")));
+    REQUIRE(base != cache::hash(parse("other.dll F+400 9090 7407")));
+    REQUIRE(base != cache::hash(parse("test.dll F+400 90*2 7407")));
+}
+
+TEST_CASE("Entries are only found for the same build", "[cache]")
+{
+    auto store = cache::store {};
+    auto const key = cache::key { .module = "test.dll", .build = build };
+
+    store.insert(key, 1, 0x1000);
+
+    REQUIRE(store.dirty());
+    REQUIRE(store.find(key, 1) == 0x1000);
+    REQUIRE(store.find({ .module = "TEST.DLL", .build = build }, 1) == 0x1000);
+    REQUIRE(!store.find(key, 2));
+
+    auto rebuilt = key;
+    rebuilt.build.timestamp += 1;
+
+    REQUIRE(!store.find(rebuilt, 1));
+
+    // resolving the new build drops the old one
+    store.insert(rebuilt, 2, 0x2000);
+
+    REQUIRE(store.size() == 1);
+    REQUIRE(!store.find(key, 1));
+    REQUIRE(store.find(rebuilt, 2) == 0x2000);
+}
+
+TEST_CASE("Cache files survive a round trip", "[cache]")
+{
+    auto store = cache::store {};
+    store.insert({ .module = "test.dll", .build = build }, 0xFEDCBA9876543210, 0x1234);
+    store.insert({ .module = "spaced name.dll", .build = build }, 7, 0x10);
+
+    REQUIRE(store.save("resolved.tmp"));
+    REQUIRE(!store.dirty());
+
+    auto const loaded = cache::store::load("resolved.tmp");
+
+    REQUIRE(loaded.size() == 2);
+    REQUIRE(loaded.find({ .module = "test.dll", .build = build }, 0xFEDCBA9876543210) == 0x1234);
+    REQUIRE(loaded.find({ .module = "spaced name.dll", .build = build }, 7) == 0x10);
+
+    {
+        auto file = std::ofstream { "resolved.tmp" };
+        file << "something else\ntest.dll\t12345678 4000 C0FFEE 1 1000\n";
+    }
+
+    REQUIRE(cache::store::load("resolved.tmp").size() == 0);
+    REQUIRE(cache::store::load("missing.tmp").size() == 0);
+
+    std::filesystem::remove("resolved.tmp");
+}
+
+TEST_CASE("Transactions resolve through the cache", "[cache]")
+{
+    auto module = test::image_builder { 0x4000 }
+        .section(".text", 0x1000, 0x400, 0x1000)
+        .write(0x1000, std::vector<std::uint8_t> { 0x74, 0x07, 0x75, 0x32 })
+        .build();
+
+    auto memory = memory::buffer { module };
+    memory.add_module("test.dll", module.data());
+
+    auto store = cache::store {};
+    auto const patch = parse("test.dll F+402 EB 75");
+    auto const key = cache::key { .module = "test.dll", .build = pe::image { module.data(), module.size() }.build() };
+
+    {
+        auto transaction = patch::transaction { memory, &store };
+        transaction.add(module.data(), patch);
+
+        REQUIRE(transaction.prepare());
+        REQUIRE(store.find(key, cache::hash(patch)) == 0x1002);
+    }
+
+    // a hit is used as is, without converting the file offset again
+    store.insert(key, cache::hash(patch), 0x1000);
+
+    auto transaction = patch::transaction { memory, &store };
+    transaction.add(module.data(), patch);
+
+    REQUIRE(!transaction.prepare());
+
+    // plain RVAs need no resolution and are never cached
+    auto const plain = parse("test.dll 1002 EB 75");
+    auto rva = patch::transaction { memory, &store };
+    rva.add(module.data(), plain);
+
+    REQUIRE(rva.prepare());
+    REQUIRE(store.size() == 1);
+}
@@ -0,0 +1,102 @@
+#include <string_view>
+#include <catch2/catch_test_macros.hpp>
+
+#include "image.h"
+#include "../src/parser.h"
+#include "../src/mempatcher.h"
+
+using namespace mempatcher;
+
+namespace
+{
+    auto make_module()
+    {
+        return test::image_builder { 0x4000 }
+            .section(".text", 0x1000, 0x400, 0x1000)
+            .write(0x1000, std::vector<std::uint8_t> { 0x74, 0x07, 0x75, 0x32 })
+            .build();
+    }
+
+    auto parse(std::string_view text, mempatcher_error* error = nullptr)
+    {
+        auto set = static_cast<mempatcher_patch_set*>(nullptr);
+        auto const status = mempatcher_parse(text.data(), text.size(), "embedded", &set, error);
+
+        return std::pair { status, set };
+    }
+}
+
+TEST_CASE("Patch sets parse from memory", "[capi]")
+{
+    auto const [status, set] = parse("# comment\r\ntest.dll 1000 9090 7407\r\nother.dll F+400 EB 75\r\n");
+
+    REQUIRE(status == MEMPATCHER_OK);
+    REQUIRE(mempatcher_patch_count(set) == 2);
+
+    mempatcher_free_patch_set(set);
+
+    auto error = mempatcher_error {};
+    auto const [failed, none] = parse("test.dll 1000 9090 7407\ntest.dll 1000 XY\n", &error);
+
+    REQUIRE(failed == MEMPATCHER_PARSE_FAILED);
+    REQUIRE(none == nullptr);
+    REQUIRE(error.line == 2);
+    REQUIRE(error.code == static_cast<int>(parser::errc::parse_bad_data_bytes));
+    REQUIRE(std::string_view { error.message } == "The data contains invalid bytes");
+
+    REQUIRE(mempatcher_parse(nullptr, 1, nullptr, nullptr, nullptr) == MEMPATCHER_INVALID_ARGUMENT);
+}
+
+TEST_CASE("Registered patches apply to matching modules", "[capi]")
+{
+    auto module = make_module();
+    auto const context = mempatcher_create();
+
+    auto const [status, set] = parse("test*.dll 1000 9090 7407\ntest.dll F+402 EB 75\nother.dll 1000 CC 74\n");
+
+    REQUIRE(status == MEMPATCHER_OK);
+    REQUIRE(mempatcher_register(context, set) == MEMPATCHER_OK);
+
+    auto applied = std::size_t {};
+
+    REQUIRE(mempatcher_apply(context, "unrelated.dll", module.data(), &applied, nullptr) == MEMPATCHER_OK);
+    REQUIRE(applied == 0);
+
+    REQUIRE(mempatcher_apply(context, "test.dll", module.data(), &applied, nullptr) == MEMPATCHER_OK);
+    REQUIRE(applied == 2);
+    REQUIRE(module[0x1000] == 0x90);
+    REQUIRE(module[0x1001] == 0x90);
+    REQUIRE(module[0x1002] == 0xEB);
+
+    REQUIRE(mempatcher_revert(context) == MEMPATCHER_OK);
+    REQUIRE(module[0x1000] == 0x74);
+    REQUIRE(module[0x1002] == 0x75);
+
+    mempatcher_destroy(context);
+}
+
+TEST_CASE("Failed applies leave the module untouched", "[capi]")
+{
+    auto module = make_module();
+    auto const context = mempatcher_create();
+
+    auto const [status, set] = parse("test.dll 1000 9090 7407\ntest.dll 1002 EB 76\n");
+
+    REQUIRE(status == MEMPATCHER_OK);
+    REQUIRE(mempatcher_register(context, set) == MEMPATCHER_OK);
+
+    auto error = mempatcher_error {};
+
+    REQUIRE(mempatcher_apply(context, "test.dll", module.data(), nullptr, &error) == MEMPATCHER_APPLY_FAILED);
+    REQUIRE(error.line == 2);
+    REQUIRE(module[0x1000] == 0x74);
+
+    REQUIRE(mempatcher_apply(nullptr, "test.dll", module.data(), nullptr, nullptr) == MEMPATCHER_INVALID_ARGUMENT);
+    REQUIRE(mempatcher_register(context, nullptr) == MEMPATCHER_INVALID_ARGUMENT);
+
+    // the set is freed even though registering failed
+    auto const [_, orphan] = parse("test.dll 1000 90 74\n");
+    REQUIRE(mempatcher_register(nullptr, orphan) == MEMPATCHER_INVALID_ARGUMENT);
+
+    mempatcher_destroy(context);
+}
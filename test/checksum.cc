@@ -0,0 +1,36 @@
+#include <vector>
+#include <string_view>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/checksum.h"
+
+using namespace mempatcher;
+
+TEST_CASE("Known CRC32C vectors match", "[checksum]")
+{
+    auto constexpr digits = std::string_view { "123456789" };
+    auto const zeros = std::vector<std::uint8_t>(32, 0x00);
+    auto const ones = std::vector<std::uint8_t>(32, 0xFF);
+
+    REQUIRE(checksum::crc32c({ reinterpret_cast<const std::uint8_t*>(digits.data()), digits.size() }) == 0xE3069283);
+    REQUIRE(checksum::crc32c(zeros) == 0x8A9136AA);
+    REQUIRE(checksum::crc32c(ones) == 0x62A8AB43);
+    REQUIRE(checksum::crc32c({}) == 0);
+}
+
+TEST_CASE("CRC32C is independent of alignment and chunking", "[checksum]")
+{
+    auto data = std::vector<std::uint8_t>(4099);
+
+    for (auto i = 0; i < data.size(); ++i)
+        data[i] = static_cast<std::uint8_t>(i * 31 + 7);
+
+    auto const whole = std::span<const std::uint8_t> { data }.subspan(3);
+    auto const expected = checksum::crc32c(whole);
+
+    for (auto split: { 1, 7, 8, 63, 1000, 4095 })
+    {
+        auto const first = checksum::crc32c(whole.first(split));
+        REQUIRE(checksum::crc32c(whole.subspan(split), first) == expected);
+    }
+}
@@ -0,0 +1,32 @@
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/compare.h"
+
+using namespace mempatcher;
+
+TEST_CASE("Masked compare ignores wildcard bytes at any position", "[compare]")
+{
+    for (auto size: std::initializer_list<std::size_t> { 0, 1, 15, 16, 17, 31, 32, 33, 64, 100 })
+    {
+        auto a = std::vector<std::uint8_t>(size);
+        auto mask = std::vector<std::uint8_t>(size, 0xFF);
+
+        for (auto i = std::size_t {}; i < size; ++i)
+            a[i] = static_cast<std::uint8_t>(i * 13 + 1);
+
+        REQUIRE(compare::masked_equal(a.data(), a.data(), mask.data(), size));
+
+        for (auto i = std::size_t {}; i < size; ++i)
+        {
+            auto b = a;
+            b[i] ^= 0x40;
+
+            REQUIRE(!compare::masked_equal(a.data(), b.data(), mask.data(), size));
+
+            mask[i] = 0x00;
+            REQUIRE(compare::masked_equal(a.data(), b.data(), mask.data(), size));
+            mask[i] = 0xFF;
+        }
+    }
+}
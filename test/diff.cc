@@ -0,0 +1,82 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "image.h"
+#include "../src/diff.h"
+
+using namespace mempatcher;
+
+namespace
+{
+    auto make_pair(std::size_t size)
+    {
+        auto a = std::vector<std::uint8_t>(size);
+
+        for (auto i = std::size_t {}; i < size; ++i)
+            a[i] = static_cast<std::uint8_t>(i * 31 + 7);
+
+        return std::pair { a, a };
+    }
+}
+
+TEST_CASE("Mismatch search finds differences at any alignment", "[diff]")
+{
+    auto [a, b] = make_pair(300);
+
+    REQUIRE(diff::next_mismatch(a, b, 0) == a.size());
+
+    for (auto position: std::initializer_list<std::size_t> { 0, 1, 15, 16, 63, 64, 65, 200, 299 })
+    {
+        auto [x, y] = make_pair(300);
+        y[position] ^= 0xFF;
+
+        REQUIRE(diff::next_mismatch(x, y, 0) == position);
+        REQUIRE(diff::next_match(x, y, position) == position + 1);
+    }
+}
+
+TEST_CASE("Differing runs are found and coalesced", "[diff]")
+{
+    auto [a, b] = make_pair(0x1000);
+
+    for (auto i: { 0x10, 0x11, 0x14, 0x100, 0x101, 0x102, 0xFFF })
+        b[i] ^= 0xFF;
+
+    auto const runs = diff::find_runs(a, b);
+
+    REQUIRE(runs.size() == 4);
+    REQUIRE(runs[0].offset == 0x10);
+    REQUIRE(runs[0].size == 2);
+    REQUIRE(runs[2].offset == 0x100);
+    REQUIRE(runs[2].size == 3);
+    REQUIRE(runs[3].offset == 0xFFF);
+
+    auto const merged = diff::find_runs(a, b, 2);
+
+    REQUIRE(merged.size() == 3);
+    REQUIRE(merged[0].offset == 0x10);
+    REQUIRE(merged[0].size == 5);
+
+    REQUIRE(diff::find_runs(a, a).empty());
+}
+
+TEST_CASE("Runs are written as patch lines with file offsets or RVAs", "[diff]")
+{
+    auto const a = test::image_builder { 0x3000 }
+        .section(".text", 0x1000, 0x400, 0x1000)
+        .section(".data", 0x2000, 0x1400, 0x1000)
+        .write(0x1FFE, std::vector<std::uint8_t> { 0x74, 0x07, 0x75, 0x32 })
+        .build(pe::layout::file);
+
+    auto b = a;
+    b[0x13FE] = 0x90;
+    b[0x13FF] = 0x90;
+    b[0x1400] = 0xEB;
+
+    auto const image = pe::image { a.data(), a.size(), pe::layout::file };
+    auto const runs = diff::split_runs(image, diff::find_runs(a, b));
+
+    REQUIRE(runs.size() == 2);
+    REQUIRE(diff::format_line(image, "test.dll", runs[0], a, b, diff::offsets::file) == "test.dll F+13FE 9090 7407");
+    REQUIRE(diff::format_line(image, "test.dll", runs[0], a, b, diff::offsets::rva) == "test.dll 1FFE 9090 7407");
+    REQUIRE(diff::format_line(image, "test dll", runs[1], a, b, diff::offsets::rva) == "\"test dll\" 2000 EB 75");
+}
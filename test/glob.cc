@@ -0,0 +1,57 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/glob.h"
+
+using namespace mempatcher;
+
+using ids = std::vector<std::size_t>;
+
+TEST_CASE("Names without wildcards are not patterns", "[glob]")
+{
+    REQUIRE(!glob::is_pattern("bm2dx.dll"));
+    REQUIRE(!glob::is_pattern("<host>"));
+    REQUIRE(!glob::is_pattern("-"));
+    REQUIRE(glob::is_pattern("bm2dx*.dll"));
+    REQUIRE(glob::is_pattern("gamemdx?b.dll"));
+}
+
+TEST_CASE("Exact targets match by name", "[glob]")
+{
+    auto const matcher = glob::matcher { { "bm2dx.dll", "gamemdx.dll", "<host>" } };
+
+    REQUIRE(matcher.size() == 3);
+    REQUIRE(matcher.match("bm2dx.dll") == ids { 0 });
+    REQUIRE(matcher.match("gamemdx.dll") == ids { 1 });
+    REQUIRE(matcher.match("bm2dx.dl").empty());
+    REQUIRE(matcher.match("").empty());
+}
+
+TEST_CASE("Pattern targets match in a single pass", "[glob]")
+{
+    auto const matcher = glob::matcher { { "bm2dx*.dll", "gamemdx.dll", "gamemdx?b.dll", "a**b*c", "*" } };
+
+    REQUIRE(matcher.match("bm2dx.dll") == ids { 0, 4 });
+    REQUIRE(matcher.match("bm2dx_omni.dll") == ids { 0, 4 });
+    REQUIRE(matcher.match("gamemdx.dll") == ids { 1, 4 });
+    REQUIRE(matcher.match("gamemdx_b.dll") == ids { 2, 4 });
+    REQUIRE(matcher.match("gamemdx__b.dll") == ids { 4 });
+    REQUIRE(matcher.match("abc") == ids { 3, 4 });
+    REQUIRE(matcher.match("aXbYcc") == ids { 3, 4 });
+    REQUIRE(matcher.match("acb") == ids { 4 });
+    REQUIRE(matcher.match("") == ids { 4 });
+}
+
+TEST_CASE("Targets match regardless of case", "[glob]")
+{
+    auto const matcher = glob::matcher { { "game.DLL", "BM2DX*.dll" } };
+
+    REQUIRE(matcher.match("GAME.dll") == ids { 0 });
+    REQUIRE(matcher.match("game.dll") == ids { 0 });
+    REQUIRE(matcher.match("bm2dx_Omni.DLL") == ids { 1 });
+}
+
+TEST_CASE("Empty matcher matches nothing", "[glob]")
+{
+    REQUIRE(glob::matcher {}.match("bm2dx.dll").empty());
+    REQUIRE(glob::matcher { {} }.match("bm2dx.dll").empty());
+}
@@ -0,0 +1,120 @@
+#include <new>
+#include <atomic>
+#include <cstdlib>
+#include <algorithm>
+
+#ifdef _WIN32
+    #include <malloc.h>
+#endif
+
+#include "heap.h"
+
+using namespace mempatcher::test;
+
+namespace mempatcher::test::heap::detail
+{
+    auto count = std::atomic<std::size_t> {};
+    auto bytes = std::atomic<std::size_t> {};
+
+    /**
+     * Allocate and count a block of memory.
+     *
+     * @param size Bytes to allocate.
+     * @return Pointer to the block.
+     */
+    auto allocate(std::size_t size) -> void*
+    {
+        count.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(size, std::memory_order_relaxed);
+
+        if (auto const result = std::malloc(size != 0 ? size: 1))
+            return result;
+
+        throw std::bad_alloc {};
+    }
+
+    /**
+     * Allocate and count a block of memory with a given alignment.
+     *
+     * @param size Bytes to allocate.
+     * @param alignment Alignment of the block, a power of two.
+     * @return Pointer to the block.
+     */
+    auto allocate(std::size_t size, std::align_val_t alignment) -> void*
+    {
+        count.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(size, std::memory_order_relaxed);
+
+        auto const align = static_cast<std::size_t>(alignment);
+
+    #ifdef _WIN32
+        auto const result = _aligned_malloc(size != 0 ? size: 1, align);
+    #else
+        // the size has to be a multiple of the alignment here
+        auto const result = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align);
+    #endif
+
+        if (result)
+            return result;
+
+        throw std::bad_alloc {};
+    }
+
+    /**
+     * Free a block from the aligned allocate.
+     *
+     * @param pointer Block to free, or null.
+     */
+    auto free_aligned(void* pointer) -> void
+    {
+    #ifdef _WIN32
+        _aligned_free(pointer);
+    #else
+        std::free(pointer);
+    #endif
+    }
+}
+
+auto heap::allocated() -> counts
+{
+    return {
+        .count = detail::count.load(std::memory_order_relaxed),
+        .bytes = detail::bytes.load(std::memory_order_relaxed)
+    };
+}
+
+auto operator new(std::size_t size) -> void*
+    { return heap::detail::allocate(size); }
+
+auto operator new[](std::size_t size) -> void*
+    { return heap::detail::allocate(size); }
+
+auto operator delete(void* pointer) noexcept -> void
+    { std::free(pointer); }
+
+auto operator delete[](void* pointer) noexcept -> void
+    { std::free(pointer); }
+
+auto operator delete(void* pointer, std::size_t) noexcept -> void
+    { std::free(pointer); }
+
+auto operator delete[](void* pointer, std::size_t) noexcept -> void
+    { std::free(pointer); }
+
+auto operator new(std::size_t size, std::align_val_t alignment) -> void*
+    { return heap::detail::allocate(size, alignment); }
+
+auto operator new[](std::size_t size, std::align_val_t alignment) -> void*
+    { return heap::detail::allocate(size, alignment); }
+
+auto operator delete(void* pointer, std::align_val_t) noexcept -> void
+    { heap::detail::free_aligned(pointer); }
+
+auto operator delete[](void* pointer, std::align_val_t) noexcept -> void
+    { heap::detail::free_aligned(pointer); }
+
+auto operator delete(void* pointer, std::size_t, std::align_val_t) noexcept -> void
+    { heap::detail::free_aligned(pointer); }
+
+auto operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept -> void
+    { heap::detail::free_aligned(pointer); }
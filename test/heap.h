@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+namespace mempatcher::test::heap
+{
+    struct counts
+    {
+        std::size_t count;
+        std::size_t bytes;
+    };
+
+    /**
+     * Allocations made through the global operator new since the program started.
+     *
+     * Counted by replacing the global allocation functions in heap.cc, so every
+     * target that includes this header has to be linked with it.
+     */
+    [[nodiscard]] auto allocated() -> counts;
+}
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/pe.h"
+#include "../src/parser.h"
+
+namespace mempatcher::test
+{
+    /**
+     * Builds minimal 64-bit PE images for tests that need real headers.
+     *
+     * Contents are placed by RVA and laid out either as mapped by the
+     * loader or as stored on disk, where each section's raw data sits at
+     * its file offset.
+     */
+    class image_builder
+    {
+    public:
+        struct export_spec
+        {
+            std::string name;
+            std::uint32_t rva {};
+            std::string forwarder {};
+        };
+
+        struct import_spec
+        {
+            std::string library;
+            std::vector<std::string> names;
+        };
+
+        explicit image_builder(std::uint32_t size_of_image = 0x4000): memory(size_of_image) {}
+
+        auto section(std::string name, std::uint32_t rva, std::uint32_t raw, std::uint32_t size) -> image_builder&
+        {
+            sections.push_back({ std::move(name), rva, raw, size });
+            return *this;
+        }
+
+        auto directory(pe::directory index, std::uint32_t rva, std::uint32_t size) -> image_builder&
+        {
+            directories[static_cast<std::size_t>(index)] = { rva, size };
+            return *this;
+        }
+
+        auto timestamp(std::uint32_t value) -> image_builder&
+        {
+            stamp = value;
+            return *this;
+        }
+
+        auto write(std::uint32_t rva, const std::vector<std::uint8_t>& bytes) -> image_builder&
+        {
+            std::memcpy(memory.data() + rva, bytes.data(), bytes.size());
+            return *this;
+        }
+
+        auto write(std::uint32_t rva, const std::string& text) -> image_builder&
+        {
+            std::memcpy(memory.data() + rva, text.c_str(), text.size() + 1);
+            return *this;
+        }
+
+        /**
+         * Add an export directory at an RVA. Exports with a forwarder string
+         * point back into the directory instead of at their RVA.
+         */
+        auto exports(std::uint32_t rva, const std::vector<export_spec>& entries) -> image_builder&
+        {
+            auto const count = static_cast<std::uint32_t>(entries.size());
+            auto const functions = rva + 40;
+            auto const names = functions + count * 4;
+            auto const ordinals = names + count * 4;
+            auto strings = ordinals + count * 2;
+
+            write(rva + 20, count).write(rva + 24, count);
+            write(rva + 28, functions).write(rva + 32, names).write(rva + 36, ordinals);
+
+            for (auto i = std::uint32_t {}; i < count; ++i)
+            {
+                write(names + i * 4, strings).write(strings, entries[i].name);
+                write(ordinals + i * 2, static_cast<std::uint16_t>(i));
+                strings += static_cast<std::uint32_t>(entries[i].name.size() + 1);
+
+                if (entries[i].forwarder.empty())
+                {
+                    write(functions + i * 4, entries[i].rva);
+                    continue;
+                }
+
+                write(functions + i * 4, strings).write(strings, entries[i].forwarder);
+                strings += static_cast<std::uint32_t>(entries[i].forwarder.size() + 1);
+            }
+
+            return directory(pe::directory::exports, rva, strings - rva);
+        }
+
+        /**
+         * Add an import directory at an RVA. Each library gets a lookup table and
+         * an address table, both holding the name entries like an unbound image.
+         */
+        auto imports(std::uint32_t rva, const std::vector<import_spec>& libraries) -> image_builder&
+        {
+            auto position = rva + static_cast<std::uint32_t>(libraries.size() + 1) * 20;
+
+            for (auto i = std::uint32_t {}; i < libraries.size(); ++i)
+            {
+                auto const& names = libraries[i].names;
+                auto const lookup = position;
+                auto const address = lookup + static_cast<std::uint32_t>(names.size() + 1) * 8;
+                position = address + static_cast<std::uint32_t>(names.size() + 1) * 8;
+
+                for (auto j = std::uint32_t {}; j < names.size(); ++j)
+                {
+                    write(lookup + j * 8, std::uint64_t { position }).write(address + j * 8, std::uint64_t { position });
+                    write(position + 2, names[j]);
+                    position += static_cast<std::uint32_t>(names[j].size() + 3);
+                }
+
+                write(rva + i * 20, lookup).write(rva + i * 20 + 12, position).write(rva + i * 20 + 16, address);
+                write(position, libraries[i].library);
+                position += static_cast<std::uint32_t>(libraries[i].library.size() + 1);
+            }
+
+            return directory(pe::directory::imports, rva, position - rva);
+        }
+
+        /**
+         * Add a relocation directory at an RVA with one 64-bit field per entry,
+         * grouped into a block for each 4 KiB page.
+         */
+        auto relocations(std::uint32_t rva, std::vector<std::uint32_t> fields) -> image_builder&
+        {
+            auto position = rva;
+
+            for (auto i = std::size_t {}; i < fields.size();)
+            {
+                auto const page = fields[i] & ~0xFFFu;
+                auto const block = position;
+                position += 8;
+
+                for (; i < fields.size() && (fields[i] & ~0xFFFu) == page; ++i, position += 2)
+                    write(position, static_cast<std::uint16_t>((10 << 12) | (fields[i] & 0xFFF)));
+
+                write(block, page).write(block + 4, position - block);
+            }
+
+            return directory(pe::directory::relocations, rva, position - rva);
+        }
+
+        template <typename T>
+        auto write(std::uint32_t rva, T value) -> image_builder&
+        {
+            std::memcpy(memory.data() + rva, &value, sizeof(T));
+            return *this;
+        }
+
+        [[nodiscard]] auto build(pe::layout layout = pe::layout::mapped) const -> std::vector<std::uint8_t>
+        {
+            auto result = memory;
+            auto const nt = std::uint32_t { 0x40 };
+            auto const optional = nt + 24;
+            auto const table = optional + 240;
+
+            put<std::uint16_t>(result, 0, 0x5A4D);
+            put<std::uint32_t>(result, 0x3C, nt);
+            put<std::uint32_t>(result, nt, 0x00004550);
+            put<std::uint16_t>(result, nt + 4, 0x8664);
+            put<std::uint16_t>(result, nt + 6, static_cast<std::uint16_t>(sections.size()));
+            put<std::uint32_t>(result, nt + 8, stamp);
+            put<std::uint16_t>(result, nt + 20, 240);
+            put<std::uint16_t>(result, optional, 0x20B);
+            put<std::uint32_t>(result, optional + 56, static_cast<std::uint32_t>(memory.size()));
+            put<std::uint32_t>(result, optional + 60, 0x400);
+            put<std::uint32_t>(result, optional + 64, 0xC0FFEE);
+            put<std::uint32_t>(result, optional + 108, 16);
+
+            for (auto i = 0; i < 16; ++i)
+            {
+                put<std::uint32_t>(result, optional + 112 + i * 8, directories[i].first);
+                put<std::uint32_t>(result, optional + 116 + i * 8, directories[i].second);
+            }
+
+            for (auto i = std::size_t {}; i < sections.size(); ++i)
+            {
+                auto const header = table + i * 40;
+                std::memcpy(result.data() + header, sections[i].name.data(), std::min<std::size_t>(sections[i].name.size(), 8));
+                put<std::uint32_t>(result, header + 8, sections[i].size);
+                put<std::uint32_t>(result, header + 12, sections[i].rva);
+                put<std::uint32_t>(result, header + 16, sections[i].size);
+                put<std::uint32_t>(result, header + 20, sections[i].raw);
+            }
+
+            if (layout == pe::layout::mapped)
+                return result;
+
+            // move each section to its file offset, keeping the headers in place
+            auto file = std::vector<std::uint8_t>(result.begin(), result.begin() + 0x400);
+
+            for (auto&& section: sections)
+            {
+                file.resize(std::max<std::size_t>(file.size(), section.raw + section.size));
+                std::memcpy(file.data() + section.raw, result.data() + section.rva, section.size);
+            }
+
+            return file;
+        }
+
+    private:
+        struct section_spec
+        {
+            std::string name;
+            std::uint32_t rva;
+            std::uint32_t raw;
+            std::uint32_t size;
+        };
+
+        std::vector<std::uint8_t> memory;
+        std::vector<section_spec> sections;
+        std::pair<std::uint32_t, std::uint32_t> directories[16] {};
+        std::uint32_t stamp { 0x12345678 };
+
+        template <typename T>
+        static auto put(std::vector<std::uint8_t>& buffer, std::size_t offset, T value) -> void
+            { std::memcpy(buffer.data() + offset, &value, sizeof(T)); }
+    };
+
+    /**
+     * Parse a single patch line, failing the test if it is invalid.
+     */
+    inline auto parse(const std::string& line) -> parser::patch
+    {
+        auto result = parser::read_line(line);
+        REQUIRE(result.has_value());
+        return *result;
+    }
+}
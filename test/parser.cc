@@ -1,9 +1,12 @@
-#include <share.h>
 #include <fstream>
 #include <catch2/catch_test_macros.hpp>
 
 #include "../src/parser.h"
 
+#ifdef _WIN32
+    #include <share.h>
+#endif
+
 using namespace mempatcher;
 
 TEST_CASE("Non-existent path fails to open", "[parse-mph]")
@@ -12,6 +15,7 @@ TEST_CASE("Non-existent path fails to open", "[parse-mph]")
     REQUIRE(parser::read_file(path).error().ec == parser::errc::file_not_found);
 }
 
+#ifdef _WIN32
 TEST_CASE("Unreadable file fails to open", "[parse-mph]")
 {
     auto file = _fsopen("lock.tmp", "w", _SH_DENYRW);
@@ -21,6 +25,7 @@ TEST_CASE("Unreadable file fails to open", "[parse-mph]")
     fclose(file);
     std::filesystem::remove("lock.tmp");
 }
+#endif
 
 TEST_CASE("Empty file returns no patches", "[parse-mph]")
 {
@@ -76,6 +81,182 @@ TEST_CASE("Invalid data bytes return error", "[parse-mph]")
     REQUIRE(parser::read_line("target.exe 123456 @1 ]2").error() == parser::errc::parse_bad_data_bytes);
 }
 
+TEST_CASE("Invalid repeat count returns error", "[parse-mph]")
+{
+    REQUIRE(parser::read_line("target.exe 123456 90*0").error() == parser::errc::parse_bad_data_repeat);
+    REQUIRE(parser::read_line("target.exe 123456 *85").error() == parser::errc::parse_bad_data_repeat);
+    REQUIRE(parser::read_line("target.exe 123456 90*8G").error() == parser::errc::parse_bad_data_repeat);
+    REQUIRE(parser::read_line("target.exe 123456 90*85CC").error() == parser::errc::parse_bad_data_repeat);
+
+    // counts that could wrap the data size, or fill more than 1 MiB in total
+    REQUIRE(parser::read_line("target.exe 123456 90*99999999999").error() == parser::errc::parse_bad_data_repeat);
+    REQUIRE(parser::read_line("target.exe 123456 90*18446744073709551615").error() == parser::errc::parse_bad_data_repeat);
+    REQUIRE(parser::read_line("target.exe 123456 90*1048576,CC*1").error() == parser::errc::parse_bad_data_repeat);
+    REQUIRE(parser::read_line("target.exe 123456 EB,90*1048575").has_value());
+}
+
+TEST_CASE("Repeated bytes parse as fill records", "[parse-mph]")
+{
+    auto const patch = parser::read_line("target.exe 123456 EB05,90*85,CC 0FB6");
+
+    REQUIRE(patch.has_value());
+    REQUIRE(patch->on.size() == 88);
+    REQUIRE(patch->on.bytes == std::pmr::vector<std::uint8_t> { 0xEB, 0x05, 0xCC });
+    REQUIRE(patch->on.fills.size() == 1);
+    REQUIRE(patch->on.fills[0].offset == 2);
+    REQUIRE(patch->on.fills[0].count == 85);
+    REQUIRE(patch->on.fills[0].value == 0x90);
+    REQUIRE(patch->off.fills.empty());
+    REQUIRE(patch->off.bytes == std::pmr::vector<std::uint8_t> { 0x0F, 0xB6 });
+}
+
+TEST_CASE("Wildcard bytes are recorded in a mask", "[parse-mph]")
+{
+    auto const patch = parser::read_line("target.dll 1000 E9????????,90*3 E8??????FF");
+
+    REQUIRE(patch.has_value());
+    REQUIRE(patch->on.bytes == std::pmr::vector<std::uint8_t> { 0xE9, 0x00, 0x00, 0x00, 0x00 });
+    REQUIRE(patch->on.mask == std::pmr::vector<std::uint8_t> { 0xFF, 0x00, 0x00, 0x00, 0x00 });
+    REQUIRE(patch->on.size() == 8);
+    REQUIRE(patch->off.mask == std::pmr::vector<std::uint8_t> { 0xFF, 0x00, 0x00, 0x00, 0xFF });
+
+    auto const plain = parser::read_line("target.dll 1000 9090 7407");
+
+    REQUIRE(plain->on.mask.empty());
+    REQUIRE(plain->off.mask.empty());
+
+    REQUIRE(parser::read_line("target.dll 1000 ??*4").error() == parser::errc::parse_bad_data_repeat);
+    REQUIRE(parser::read_line("target.dll 1000 9?").error() == parser::errc::parse_bad_data_bytes);
+    REQUIRE(parser::read_line("target.dll 1000 ?9").error() == parser::errc::parse_bad_data_bytes);
+
+    // digits followed by anything other than '?' parse as before
+    auto const lenient = parser::read_line("target.dll 1000 1G");
+    REQUIRE(lenient.has_value());
+    REQUIRE(lenient->on.bytes == std::pmr::vector<std::uint8_t> { 0x01 });
+}
+
+TEST_CASE("Invalid checksum checks return error", "[parse-mph]")
+{
+    REQUIRE(parser::read_line("target.dll crc:.text 1A2B3C4D 11").error() == parser::errc::parse_too_many_args);
+    REQUIRE(parser::read_line("target.dll crc: 1A2B3C4D").error() == parser::errc::parse_bad_checksum_region);
+    REQUIRE(parser::read_line("target.dll crc:.toolongname 1A2B3C4D").error() == parser::errc::parse_bad_checksum_region);
+    REQUIRE(parser::read_line("target.dll crc:F+400:0 1A2B3C4D").error() == parser::errc::parse_bad_checksum_region);
+    REQUIRE(parser::read_line("target.dll crc:F+400:ZZ 1A2B3C4D").error() == parser::errc::parse_bad_checksum_region);
+    REQUIRE(parser::read_line("target.dll crc:huh:100 1A2B3C4D").error() == parser::errc::parse_bad_offset_address);
+    REQUIRE(parser::read_line("target.dll crc:.text 1A2B3C4D5").error() == parser::errc::parse_bad_checksum_value);
+    REQUIRE(parser::read_line("target.dll crc:.text XYZ").error() == parser::errc::parse_bad_checksum_value);
+    REQUIRE(parser::read_line("- crc:.text 1A2B3C4D").error() == parser::errc::parse_bad_checksum_region);
+}
+
+TEST_CASE("Checksum checks parse successfully", "[parse-mph]")
+{
+    auto const section = parser::read_line("bm2dx.dll crc:.text 1A2B3C4D");
+
+    REQUIRE(section.has_value());
+    REQUIRE(section->crc.has_value());
+    REQUIRE(section->crc->section == ".text");
+    REQUIRE(section->crc->value == 0x1A2B3C4D);
+    REQUIRE(section->on.empty());
+    REQUIRE(section->off.empty());
+
+    auto const range = parser::read_line("bm2dx.dll crc:F+400:1000 abcd");
+
+    REQUIRE(range.has_value());
+    REQUIRE(range->type == parser::addr_type::file);
+    REQUIRE(range->address == 0x400);
+    REQUIRE(range->crc->section.empty());
+    REQUIRE(range->crc->size == 0x1000);
+    REQUIRE(range->crc->value == 0xABCD);
+}
+
+TEST_CASE("Invalid export offsets return error", "[parse-mph]")
+{
+    REQUIRE(parser::read_line("target.dll ! 90").error() == parser::errc::parse_bad_offset_address);
+    REQUIRE(parser::read_line("target.dll !+1C 90").error() == parser::errc::parse_bad_offset_address);
+    REQUIRE(parser::read_line("target.dll !Update+ 90").error() == parser::errc::parse_bad_offset_address);
+    REQUIRE(parser::read_line("target.dll !Update+XY 90").error() == parser::errc::parse_bad_offset_address);
+    REQUIRE(parser::read_line("- !Update 90").error() == parser::errc::parse_bad_offset_address);
+}
+
+TEST_CASE("Export offsets parse successfully", "[parse-mph]")
+{
+    auto const patch = parser::read_line("target.dll !Update+1C 90 74");
+
+    REQUIRE(patch.has_value());
+    REQUIRE(patch->type == parser::addr_type::symbol);
+    REQUIRE(patch->symbol == "Update");
+    REQUIRE(patch->address == 0x1C);
+
+    auto const prefixed = parser::read_line("target.dll !Update+0x1c 90");
+
+    REQUIRE(prefixed.has_value());
+    REQUIRE(prefixed->address == 0x1C);
+
+    auto const plain = parser::read_line("target.dll !Update 90");
+
+    REQUIRE(plain.has_value());
+    REQUIRE(plain->address == 0);
+
+    auto const crc = parser::read_line("target.dll crc:!Update:20 1A2B3C4D");
+
+    REQUIRE(crc.has_value());
+    REQUIRE(crc->type == parser::addr_type::symbol);
+    REQUIRE(crc->symbol == "Update");
+    REQUIRE(crc->crc->size == 0x20);
+}
+
+TEST_CASE("Import slot offsets parse successfully", "[parse-mph]")
+{
+    auto const patch = parser::read_line("bm2dx.dll iat:kernel32.dll!Sleep 0000000000000000");
+
+    REQUIRE(patch.has_value());
+    REQUIRE(patch->type == parser::addr_type::iat);
+    REQUIRE(patch->library == "kernel32.dll");
+    REQUIRE(patch->symbol == "Sleep");
+
+    REQUIRE(parser::read_line("bm2dx.dll iat:kernel32.dll 00").error() == parser::errc::parse_bad_offset_address);
+    REQUIRE(parser::read_line("bm2dx.dll iat:!Sleep 00").error() == parser::errc::parse_bad_offset_address);
+    REQUIRE(parser::read_line("bm2dx.dll iat:kernel32.dll! 00").error() == parser::errc::parse_bad_offset_address);
+    REQUIRE(parser::read_line("- iat:kernel32.dll!Sleep 00").error() == parser::errc::parse_bad_offset_address);
+
+    // slots hold exactly one pointer
+    REQUIRE(parser::read_line("bm2dx.dll iat:kernel32.dll!Sleep 00000000").has_value());
+    REQUIRE(parser::read_line("bm2dx.dll iat:kernel32.dll!Sleep 0000").error() == parser::errc::parse_bad_data_length);
+    REQUIRE(parser::read_line("bm2dx.dll iat:kernel32.dll!Sleep 00*16").error() == parser::errc::parse_bad_data_length);
+    REQUIRE(parser::read_line("bm2dx.dll iat:kernel32.dll!Sleep 00000000 0000000000000000").error() == parser::errc::parse_bad_data_length);
+}
+
+TEST_CASE("Retry options parse successfully", "[parse-mph]")
+{
+    auto const plain = parser::read_line("target.dll 1000 90 74");
+
+    REQUIRE(plain.has_value());
+    REQUIRE(!plain->retry.has_value());
+
+    auto const both = parser::read_line("target.dll 1000 90 74 retry");
+
+    REQUIRE(both.has_value());
+    REQUIRE(both->retry == std::chrono::milliseconds { 10000 });
+    REQUIRE(both->off.bytes == std::pmr::vector<std::uint8_t> { 0x74 });
+
+    auto const deadline = parser::read_line("target.dll 1000 90 retry:30000");
+
+    REQUIRE(deadline.has_value());
+    REQUIRE(deadline->retry == std::chrono::milliseconds { 30000 });
+    REQUIRE(deadline->off.empty());
+
+    auto const crc = parser::read_line("target.dll crc:.text 1A2B3C4D retry:500");
+
+    REQUIRE(crc.has_value());
+    REQUIRE(crc->retry == std::chrono::milliseconds { 500 });
+
+    REQUIRE(parser::read_line("target.dll 1000 retry").error() == parser::errc::parse_bad_data_length);
+    REQUIRE(parser::read_line("target.dll 1000 90 retry:").error() == parser::errc::parse_bad_retry_deadline);
+    REQUIRE(parser::read_line("target.dll 1000 90 retry:0").error() == parser::errc::parse_bad_retry_deadline);
+    REQUIRE(parser::read_line("target.dll 1000 90 retry:1s").error() == parser::errc::parse_bad_retry_deadline);
+    REQUIRE(parser::read_line("target.dll 1000 90 74 retry 11").error() == parser::errc::parse_too_many_args);
+}
+
 TEST_CASE("Valid patches parse successfully", "[parse-mph]")
 {
     REQUIRE(parser::read_line("\"spaced target.exe\" ABCDEF 11 22").has_value());
@@ -96,6 +277,22 @@ TEST_CASE("Valid patches parse successfully", "[parse-mph]")
     std::filesystem::remove("valid.mph");
 }
 
+TEST_CASE("Buffers parse like files", "[parse-mph]")
+{
+    auto const patches = parser::read_buffer("# comment\r\n\r\ntarget.dll 123456 11 22\r\ntarget.dll 1000 90", "buffer");
+
+    REQUIRE(patches.has_value());
+    REQUIRE(patches->size() == 2);
+    REQUIRE((*patches)[0].line == 3);
+    REQUIRE((*patches)[0].file == "buffer");
+    REQUIRE((*patches)[0].off.bytes == std::pmr::vector<std::uint8_t> { 0x22 });
+
+    auto const invalid = parser::read_buffer("target.dll 1000 90\ntarget.dll XYZ 90\n", "buffer");
+
+    REQUIRE(invalid.error().ec == parser::errc::parse_bad_offset_address);
+    REQUIRE(invalid.error().line == 2);
+}
+
 TEST_CASE("Invalid patch in file has line number", "[parse-mph]")
 {
     {
@@ -106,4 +303,27 @@ TEST_CASE("Invalid patch in file has line number", "[parse-mph]")
 
     REQUIRE(parser::read_file("valid.mph").error().line == 6);
     std::filesystem::remove("valid.mph");
-}
\ No newline at end of file
+}
+TEST_CASE("Files are read in chunks", "[parse-mph]")
+{
+    {
+        auto file = std::ofstream { "chunks.mph" };
+
+        for (auto i = 0; i < 5; ++i)
+            file << "target.dll 1000 90\n# comment\n";
+    }
+
+    auto sizes = std::vector<std::size_t> {};
+    auto const total = parser::read_file("chunks.mph", [&] (auto&& chunk)
+        { sizes.push_back(chunk.size()); return true; }, 2);
+
+    REQUIRE(total == 5);
+    REQUIRE(sizes == std::vector<std::size_t> { 2, 2, 1 });
+
+    auto const cancelled = parser::read_file("chunks.mph", [] (auto&&) { return false; }, 2);
+
+    REQUIRE(cancelled.error().ec == parser::errc::read_cancelled);
+    REQUIRE(cancelled.error().line == 3);
+
+    std::filesystem::remove("chunks.mph");
+}
@@ -0,0 +1,546 @@
+#include <new>
+#include <array>
+#include <format>
+#include <cstring>
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+
+#include "image.h"
+#include "../src/patch.h"
+#include "../src/atomic.h"
+#include "../src/checksum.h"
+
+using namespace mempatcher;
+using test::parse;
+
+namespace
+{
+    auto make_module()
+    {
+        return test::image_builder { 0x4000 }
+            .section(".text", 0x1000, 0x400, 0x1000)
+            .section(".data", 0x2000, 0x1400, 0x1000)
+            .write(0x1000, std::vector<std::uint8_t> { 0x74, 0x07, 0x75, 0x32, 0xC0 })
+            .write(0x2000, std::vector<std::uint8_t> { 0x64, 0x61, 0x74, 0x61 })
+            .build();
+    }
+
+    /**
+     * Buffer backend that records every write and fill, along with two
+     * watched bytes as they were right after each one.
+     */
+    class recording_backend final: public memory::backend
+    {
+    public:
+        struct write_record
+        {
+            std::size_t offset;
+            std::size_t size;
+            std::array<std::uint8_t, 2> watched;
+        };
+
+        recording_backend(std::span<std::uint8_t> memory, std::size_t watch):
+            inner { memory }, memory { memory }, watch { watch } {}
+
+        auto read(const std::uint8_t* address, std::span<std::uint8_t> out) -> bool override
+            { return inner.read(address, out); }
+
+        auto write(std::uint8_t* address, std::span<const std::uint8_t> data) -> bool override
+        {
+            if (throwing)
+                throw std::bad_alloc {};
+
+            return record(address, data.size(), inner.write(address, data));
+        }
+
+        auto fill(std::uint8_t* address, std::uint8_t value, std::size_t count) -> bool override
+            { return record(address, count, inner.fill(address, value, count)); }
+
+        auto checksum(const std::uint8_t* address, std::size_t size) -> std::optional<std::uint32_t> override
+            { return inner.checksum(address, size); }
+
+        auto unprotect(std::uint8_t* page) -> std::optional<std::uint32_t> override
+            { return inner.unprotect(page); }
+
+        auto protect(std::uint8_t* page, std::uint32_t protection) -> bool override
+            { return inner.protect(page, protection); }
+
+        auto page_size() const -> std::size_t override
+            { return inner.page_size(); }
+
+        [[nodiscard]] auto writable(const std::uint8_t* address) const -> bool
+            { return inner.writable(address); }
+
+        std::vector<write_record> writes;
+        bool throwing {};
+
+    private:
+        memory::buffer inner;
+        std::span<std::uint8_t> memory;
+        std::size_t watch;
+
+        auto record(const std::uint8_t* address, std::size_t size, bool result) -> bool
+        {
+            writes.push_back({ .offset = static_cast<std::size_t>(address - memory.data()), .size = size,
+                .watched = { memory[watch], memory[watch + 1] } });
+
+            return result;
+        }
+    };
+}
+
+TEST_CASE("Transaction applies every patch and restores protection", "[patch]")
+{
+    auto module = make_module();
+    auto memory = memory::buffer { module };
+    auto const base = module.data();
+
+    auto const patches = std::vector {
+        parse("test.dll 1000 9090 7407"),
+        parse("test.dll F+402 EB 75"),
+        parse("test.dll 2000 90*4 64617461"),
+    };
+
+    auto transaction = patch::transaction { memory };
+
+    for (auto&& patch: patches)
+        transaction.add(base, patch);
+
+    REQUIRE(transaction.prepare());
+    REQUIRE(transaction.commit());
+
+    REQUIRE(module[0x1000] == 0x90);
+    REQUIRE(module[0x1001] == 0x90);
+    REQUIRE(module[0x1002] == 0xEB);
+    REQUIRE(module[0x2000] == 0x90);
+    REQUIRE(module[0x2003] == 0x90);
+    REQUIRE(!memory.writable(base + 0x1000));
+    REQUIRE(!memory.writable(base + 0x2000));
+
+    REQUIRE(transaction.changes().entries.size() == 3);
+    REQUIRE(transaction.changes().bytes.size() == 7);
+}
+
+TEST_CASE("Failed compare leaves memory untouched", "[patch]")
+{
+    auto module = make_module();
+    auto const original = module;
+    auto memory = memory::buffer { module };
+
+    auto const patches = std::vector {
+        parse("test.dll 1000 9090 7407"),
+        parse("test.dll 2000 6F6D6E69 DEADBEEF"),
+    };
+
+    auto transaction = patch::transaction { memory };
+
+    for (auto&& patch: patches)
+        transaction.add(module.data(), patch);
+
+    REQUIRE(!transaction.prepare());
+    REQUIRE(transaction.failed() == &patches[1]);
+    REQUIRE(!transaction.commit());
+    REQUIRE(module == original);
+}
+
+TEST_CASE("Failed write is rolled back from the journal", "[patch]")
+{
+    auto module = make_module();
+    auto const original = module;
+
+    // the last page is only partially backed, so the second patch fails after the first is written
+    auto memory = memory::buffer { std::span { module }.first(0x3FF2), 0x10 };
+
+    auto const patches = std::vector {
+        parse("test.dll 1000 9090 7407"),
+        parse("test.dll 3FF0 11223344"),
+    };
+
+    auto transaction = patch::transaction { memory };
+
+    for (auto&& patch: patches)
+        transaction.add(module.data(), patch);
+
+    REQUIRE(transaction.prepare());
+    REQUIRE(!transaction.commit());
+    REQUIRE(module == original);
+    REQUIRE(!memory.writable(module.data() + 0x1000));
+}
+
+TEST_CASE("Failed unprotect leaves memory untouched", "[patch]")
+{
+    auto module = make_module();
+    auto const original = module;
+    auto memory = memory::buffer { module };
+
+    auto const patches = std::vector {
+        parse("test.dll 1000 9090 7407"),
+        parse("test.dll 2000 6F6D6E69 64617461"),
+    };
+
+    auto transaction = patch::transaction { memory };
+
+    for (auto&& patch: patches)
+        transaction.add(module.data(), patch);
+
+    memory.lock(module.data() + 0x2000);
+
+    REQUIRE(transaction.prepare());
+    REQUIRE(!transaction.commit());
+    REQUIRE(module == original);
+}
+
+TEST_CASE("Committed transaction can be rolled back", "[patch]")
+{
+    auto module = make_module();
+    auto const original = module;
+    auto memory = memory::buffer { module };
+
+    auto const patches = std::vector {
+        parse("test.dll 1000 9090 7407"),
+        parse("test.dll 1001 EBEB"),
+    };
+
+    auto transaction = patch::transaction { memory };
+
+    for (auto&& patch: patches)
+        transaction.add(module.data(), patch);
+
+    REQUIRE(transaction.prepare());
+    REQUIRE(transaction.commit());
+    REQUIRE(module[0x1001] == 0xEB);
+    REQUIRE(transaction.rollback());
+    REQUIRE(module == original);
+    REQUIRE(!transaction.rollback());
+}
+
+TEST_CASE("Large patches are written in full and rolled back", "[patch]")
+{
+    auto module = make_module();
+    auto const original = module;
+    auto memory = memory::buffer { module };
+    auto const patch = parse("test.dll 1003 EB05,90*85,CC");
+
+    auto transaction = patch::transaction { memory };
+    transaction.add(module.data(), patch);
+
+    REQUIRE(transaction.prepare());
+    REQUIRE(transaction.commit());
+    REQUIRE(module[0x1003] == 0xEB);
+    REQUIRE(module[0x1004] == 0x05);
+    REQUIRE(std::all_of(&module[0x1005], &module[0x105A], [] (auto byte) { return byte == 0x90; }));
+    REQUIRE(module[0x105A] == 0xCC);
+
+    REQUIRE(transaction.rollback());
+    REQUIRE(module == original);
+}
+
+TEST_CASE("Large patches park the head before writing the tail", "[patch]")
+{
+    auto module = make_module();
+    auto const start = std::size_t { 0x1003 };
+
+    // the head has to be stored at once for parking to be used at all
+    REQUIRE(atomic::fits(module.data() + start, 2));
+
+    auto memory = recording_backend { module, start };
+    auto const patch = parse("test.dll 1003 EB05,90*85,CC");
+
+    auto transaction = patch::transaction { memory };
+    transaction.add(module.data(), patch);
+
+    REQUIRE(transaction.prepare());
+    REQUIRE(transaction.commit());
+
+    auto const& writes = memory.writes;
+    auto const park = std::array<std::uint8_t, 2> { 0xEB, 0xFE };
+    auto const head = std::array<std::uint8_t, 2> { 0xEB, 0x05 };
+    auto const before = std::array<std::uint8_t, 2> { 0x32, 0xC0 };
+
+    REQUIRE(writes.size() >= 3);
+
+    // 'jmp $' first, then everything after the head, then the real head
+    REQUIRE(writes.front().offset == start);
+    REQUIRE(writes.front().size == 2);
+    REQUIRE(writes.front().watched == park);
+
+    REQUIRE(writes.back().offset == start);
+    REQUIRE(writes.back().size == 2);
+    REQUIRE(writes.back().watched == head);
+
+    for (auto i = std::size_t { 1 }; i + 1 < writes.size(); ++i)
+    {
+        REQUIRE(writes[i].offset >= start + 2);
+        REQUIRE(writes[i].watched == park);
+    }
+
+    // no write ever leaves the head half replaced
+    for (auto&& write: writes)
+        REQUIRE((write.watched == before || write.watched == park || write.watched == head));
+
+    // the rollback restores the head last, through the same parking
+    auto const committed = writes.size();
+    REQUIRE(transaction.rollback());
+
+    for (auto i = committed; i < writes.size(); ++i)
+        REQUIRE((writes[i].watched == before || writes[i].watched == park || writes[i].watched == head));
+
+    REQUIRE(writes.back().watched == before);
+}
+
+TEST_CASE("Large patches with a split head write the head last", "[patch]")
+{
+    auto module = make_module();
+    auto const start = std::size_t { 0x100F };
+
+    REQUIRE(!atomic::fits(module.data() + start, 2));
+
+    auto memory = recording_backend { module, start };
+    auto const patch = parse("test.dll 100F EB05,90*20 0000,00*20");
+
+    auto transaction = patch::transaction { memory };
+    transaction.add(module.data(), patch);
+
+    REQUIRE(transaction.prepare());
+    REQUIRE(transaction.commit());
+
+    auto const& writes = memory.writes;
+    auto const before = std::array<std::uint8_t, 2> { 0x00, 0x00 };
+    auto const head = std::array<std::uint8_t, 2> { 0xEB, 0x05 };
+
+    REQUIRE(writes.size() >= 2);
+
+    // the old head stays in place until everything behind it is written
+    for (auto i = std::size_t {}; i + 1 < writes.size(); ++i)
+    {
+        REQUIRE(writes[i].offset >= start + 2);
+        REQUIRE(writes[i].watched == before);
+    }
+
+    REQUIRE(writes.back().offset == start);
+    REQUIRE(writes.back().watched == head);
+}
+
+TEST_CASE("Later patches are verified against earlier ones", "[patch]")
+{
+    auto module = make_module();
+    auto const original = module;
+    auto memory = memory::buffer { module };
+
+    // chained: the second line expects exactly what the first one writes
+    // overlapping: the fourth line expects a mix of original and written bytes
+    auto const patches = std::vector {
+        parse("test.dll 1000 9090 7407"),
+        parse("test.dll 1000 EBFE 9090"),
+        parse("test.dll 1002 AAAA 7532"),
+        parse("test.dll 1001 CCCCCC FEAAAA"),
+        parse("test.dll 1002 ??BB CCCC"),
+    };
+
+    auto transaction = patch::transaction { memory };
+
+    for (auto&& patch: patches)
+        transaction.add(module.data(), patch);
+
+    REQUIRE(transaction.prepare());
+    REQUIRE(transaction.commit());
+    REQUIRE(std::ranges::equal(std::span { module }.subspan(0x1000, 5),
+        std::vector<std::uint8_t> { 0xEB, 0xCC, 0xCC, 0xBB, 0xC0 }));
+
+    REQUIRE(transaction.rollback());
+    REQUIRE(module == original);
+
+    // expecting the original bytes after an earlier line replaced them still fails
+    auto const stale = std::vector {
+        parse("test.dll 1000 9090 7407"),
+        parse("test.dll 1000 EBFE 7407"),
+    };
+
+    auto failing = patch::transaction { memory };
+
+    for (auto&& patch: stale)
+        failing.add(module.data(), patch);
+
+    REQUIRE(!failing.prepare());
+    REQUIRE(failing.failed() == &stale[1]);
+    REQUIRE(module == original);
+}
+
+TEST_CASE("Patches added out of order take effect in file order", "[patch]")
+{
+    auto module = make_module();
+    auto memory = memory::buffer { module };
+
+    // added grouped as if by target, second line first
+    auto first = parse("test.dll 1000 9090 7407");
+    auto second = parse("test.dll 1000 EBFE 9090");
+
+    first.order = 0;
+    second.order = 1;
+
+    auto transaction = patch::transaction { memory };
+    transaction.add(module.data(), second);
+    transaction.add(module.data(), first);
+
+    REQUIRE(transaction.prepare());
+    REQUIRE(transaction.commit());
+    REQUIRE(module[0x1000] == 0xEB);
+    REQUIRE(module[0x1001] == 0xFE);
+}
+
+TEST_CASE("Already applied patches verify successfully", "[patch]")
+{
+    auto module = make_module();
+    auto memory = memory::buffer { module };
+    auto const patch = parse("test.dll 1000 7407 9090");
+
+    REQUIRE(patch::apply(module.data(), patch, memory));
+    REQUIRE(patch::apply(module.data(), patch, memory));
+}
+
+TEST_CASE("Checksum checks verify sections and ranges", "[patch]")
+{
+    auto module = make_module();
+    auto memory = memory::buffer { module };
+
+    auto const text = checksum::crc32c({ module.data() + 0x1000, 0x1000 });
+    auto const range = checksum::crc32c({ module.data() + 0x1000, 0x10 });
+
+    REQUIRE(patch::apply(module.data(), parse(std::format("test.dll crc:.text {:08X}", text)), memory));
+    REQUIRE(patch::apply(module.data(), parse(std::format("test.dll crc:F+400:10 {:08X}", range)), memory));
+    REQUIRE(!patch::apply(module.data(), parse(std::format("test.dll crc:.text {:08X}", ~text)), memory));
+    REQUIRE(!patch::apply(module.data(), parse("test.dll crc:.rdata 00000000"), memory));
+}
+
+TEST_CASE("Checksums after earlier patches in a transaction see the patched bytes", "[patch]")
+{
+    auto module = make_module();
+    auto memory = memory::buffer { module };
+
+    auto patched = module;
+    patched[0x1000] = 0x90;
+    patched[0x1001] = 0x90;
+
+    auto const after = checksum::crc32c({ patched.data() + 0x1000, 0x10 });
+    auto const before = checksum::crc32c({ module.data() + 0x1000, 0x10 });
+
+    auto const nop = parse("test.dll 1000 9090 7407");
+    auto const current = parse(std::format("test.dll crc:F+400:10 {:08X}", after));
+    auto const stale = parse(std::format("test.dll crc:F+400:10 {:08X}", before));
+
+    auto transaction = patch::transaction { memory };
+    transaction.add(module.data(), nop);
+    transaction.add(module.data(), current);
+
+    REQUIRE(transaction.prepare());
+
+    auto failing = patch::transaction { memory };
+    failing.add(module.data(), nop);
+    failing.add(module.data(), stale);
+
+    REQUIRE(!failing.prepare());
+    REQUIRE(failing.failed() == &stale);
+}
+
+TEST_CASE("Pages are protected again when a write throws", "[patch]")
+{
+    auto module = make_module();
+    auto memory = recording_backend { module, 0x1000 };
+    auto const patch = parse("test.dll 1000 9090 7407");
+
+    auto transaction = patch::transaction { memory };
+    transaction.add(module.data(), patch);
+
+    REQUIRE(transaction.prepare());
+
+    memory.throwing = true;
+
+    REQUIRE_THROWS_AS(transaction.commit(), std::bad_alloc);
+    REQUIRE(!memory.writable(module.data() + 0x1000));
+}
+
+TEST_CASE("Export offsets resolve through the export index", "[patch]")
+{
+    auto kernelbase = test::image_builder { 0x3000 }
+        .section(".text", 0x1000, 0x400, 0x1000)
+        .section(".rdata", 0x2000, 0x1400, 0x1000)
+        .exports(0x2000, { { .name = "Sleep", .rva = 0x1040 } })
+        .write(0x1040, std::vector<std::uint8_t> { 0x48, 0x83 })
+        .build();
+
+    auto module = test::image_builder { 0x4000 }
+        .section(".text", 0x1000, 0x400, 0x1000)
+        .section(".rdata", 0x3000, 0x2400, 0x1000)
+        .exports(0x3000, {
+            { .name = "Update", .rva = 0x1000 },
+            { .name = "Sleep", .forwarder = "KERNELBASE.Sleep" },
+            { .name = "Loop", .forwarder = "TEST.Loop" },
+        })
+        .write(0x1000, std::vector<std::uint8_t> { 0x74, 0x07, 0x75, 0x32, 0xC0 })
+        .build();
+
+    // both images live in one buffer so a single backend covers them
+    module.insert(module.end(), kernelbase.begin(), kernelbase.end());
+    auto const base = module.data();
+    auto const forwarded = module.data() + 0x4000;
+
+    auto memory = memory::buffer { module };
+    memory.add_module("KERNELBASE.dll", forwarded);
+    memory.add_module("TEST.dll", base);
+
+    REQUIRE(patch::apply(base, parse("test.dll !Update+2 EB 75"), memory));
+    REQUIRE(module[0x1002] == 0xEB);
+
+    REQUIRE(patch::apply(base, parse("test.dll !Sleep C3 48"), memory));
+    REQUIRE(module[0x4000 + 0x1040] == 0xC3);
+
+    REQUIRE(!patch::apply(base, parse("test.dll !Missing 90"), memory));
+    REQUIRE(!patch::apply(base, parse("test.dll !Loop 90"), memory));
+}
+
+TEST_CASE("Import slot patches are verified and written", "[patch]")
+{
+    auto module = test::image_builder { 0x4000 }
+        .section(".text", 0x1000, 0x400, 0x1000)
+        .section(".rdata", 0x2000, 0x1400, 0x1000)
+        .imports(0x2000, { { .library = "KERNEL32.dll", .names = { "GetTickCount", "Sleep" } } })
+        .build();
+
+    auto const base = module.data();
+    auto const slot = *pe::import_index { pe::image { base, module.size() } }.find("kernel32.dll", "Sleep");
+
+    // simulate the loader binding the slot
+    auto const bound = std::uint64_t { 0x00007FF812345678 };
+    std::memcpy(base + slot, &bound, sizeof(bound));
+
+    auto memory = memory::buffer { module };
+
+    REQUIRE(!patch::apply(base, parse("test.dll iat:kernel32.dll!Sleep 1111111111111111 0000000000000000"), memory));
+    REQUIRE(patch::apply(base, parse("test.dll iat:kernel32.dll!Sleep 1111111111111111 78563412F87F0000"), memory));
+    REQUIRE(std::all_of(base + slot, base + slot + 8, [] (auto byte) { return byte == 0x11; }));
+    REQUIRE(!patch::apply(base, parse("test.dll iat:kernel32.dll!Missing 1111111111111111"), memory));
+
+    // a 32-bit pointer in a 64-bit slot is rejected instead of writing half of it
+    REQUIRE(!patch::apply(base, parse("test.dll iat:kernel32.dll!Sleep 22222222"), memory));
+    REQUIRE(std::all_of(base + slot, base + slot + 8, [] (auto byte) { return byte == 0x11; }));
+}
+
+TEST_CASE("Wildcards skip expected bytes and keep replaced bytes", "[patch]")
+{
+    auto module = make_module();
+    auto memory = memory::buffer { module };
+
+    // 0x1001 differs from the expected data, but is a wildcard
+    REQUIRE(!patch::apply(module.data(), parse("test.dll 1000 EB 7408"), memory));
+    REQUIRE(patch::apply(module.data(), parse("test.dll 1000 EB??90 74??75"), memory));
+
+    REQUIRE(module[0x1000] == 0xEB);
+    REQUIRE(module[0x1001] == 0x07);
+    REQUIRE(module[0x1002] == 0x90);
+
+    // large patches keep wildcard bytes as well
+    REQUIRE(patch::apply(module.data(), parse("test.dll 1000 CC??CC,CC*40"), memory));
+    REQUIRE(module[0x1000] == 0xCC);
+    REQUIRE(module[0x1001] == 0x07);
+    REQUIRE(module[0x102A] == 0xCC);
+}
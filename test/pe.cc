@@ -0,0 +1,143 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "image.h"
+#include "../src/pe.h"
+
+using namespace mempatcher;
+
+namespace
+{
+    auto make_module(pe::layout layout = pe::layout::mapped)
+    {
+        return test::image_builder { 0x4000 }
+            .section(".text", 0x1000, 0x400, 0x1000)
+            .section(".rdata", 0x2000, 0x1400, 0x1000)
+            .exports(0x2000, {
+                { .name = "Update", .rva = 0x1010 },
+                { .name = "Render", .rva = 0x1200 },
+                { .name = "Sleep", .forwarder = "KERNELBASE.Sleep" },
+            })
+            .build(layout);
+    }
+}
+
+TEST_CASE("Sections and directories are read from headers", "[pe]")
+{
+    auto const module = make_module();
+    auto const image = pe::image { module.data(), module.size() };
+
+    REQUIRE(image.valid());
+    REQUIRE(image.sections().size() == 2);
+    REQUIRE(image.find_section(".rdata")->virtual_address == 0x2000);
+    REQUIRE(image.find_section(".data") == nullptr);
+    REQUIRE(image.find_directory(pe::directory::exports)->rva == 0x2000);
+    REQUIRE(!image.find_directory(pe::directory::imports));
+    REQUIRE(image.file2rva(0x410) == 0x1010);
+    REQUIRE(image.rva2file(0x2010) == 0x1410);
+}
+
+TEST_CASE("Truncated images are rejected", "[pe]")
+{
+    auto const module = make_module();
+
+    REQUIRE(!pe::image { module.data(), 0x40 }.valid());
+    REQUIRE(!pe::image { nullptr, 0 }.valid());
+    REQUIRE(pe::image { module.data(), module.size() }.at(0x3FFF, 2) == nullptr);
+}
+
+TEST_CASE("Export index finds named exports and forwarders", "[pe]")
+{
+    for (auto layout: { pe::layout::mapped, pe::layout::file })
+    {
+        auto const module = make_module(layout);
+        auto const exports = pe::export_index { pe::image { module.data(), module.size(), layout } };
+
+        REQUIRE(exports.size() == 3);
+        REQUIRE(exports.find("Update")->rva == 0x1010);
+        REQUIRE(exports.find("Render")->forwarder.empty());
+        REQUIRE(exports.find("Sleep")->forwarder == "KERNELBASE.Sleep");
+        REQUIRE(exports.find("update") == nullptr);
+    }
+}
+
+TEST_CASE("Images without exports have an empty index", "[pe]")
+{
+    auto const module = test::image_builder {}.section(".text", 0x1000, 0x400, 0x1000).build();
+
+    REQUIRE(pe::export_index { pe::image { module.data(), module.size() } }.size() == 0);
+}
+
+TEST_CASE("Import index finds address table slots", "[pe]")
+{
+    auto const module = test::image_builder { 0x4000 }
+        .section(".text", 0x1000, 0x400, 0x1000)
+        .section(".rdata", 0x2000, 0x1400, 0x1000)
+        .imports(0x2000, {
+            { .library = "KERNEL32.dll", .names = { "Sleep", "GetTickCount" } },
+            { .library = "user32.dll", .names = { "MessageBoxA" } },
+        })
+        .build();
+
+    auto const image = pe::image { module.data(), module.size() };
+    auto const imports = pe::import_index { image };
+
+    REQUIRE(imports.size() == 3);
+
+    auto const sleep = imports.find("kernel32.dll", "Sleep");
+    auto const ticks = imports.find("Kernel32.DLL", "GetTickCount");
+
+    REQUIRE(sleep.has_value());
+    REQUIRE(ticks == *sleep + 8);
+    REQUIRE(imports.find("user32.dll", "MessageBoxA").has_value());
+    REQUIRE(!imports.find("user32.dll", "Sleep"));
+    REQUIRE(!imports.find("ntdll.dll", "Sleep"));
+
+    // unbound slots still point at the hint and name entry
+    auto const entry = *reinterpret_cast<const std::uint32_t*>(image.at(*sleep, 8));
+    REQUIRE(image.string_at(entry + 2) == "Sleep");
+}
+
+TEST_CASE("Import descriptors without a lookup table are skipped", "[pe]")
+{
+    auto module = test::image_builder { 0x4000 }
+        .section(".text", 0x1000, 0x400, 0x1000)
+        .section(".rdata", 0x2000, 0x1400, 0x1000)
+        .imports(0x2000, {
+            { .library = "KERNEL32.dll", .names = { "Sleep" } },
+            { .library = "user32.dll", .names = { "MessageBoxA" } },
+        })
+        .build();
+
+    // the address table of a loaded image holds pointers, not name entries
+    std::memset(module.data() + 0x2000, 0, sizeof(std::uint32_t));
+
+    auto const imports = pe::import_index { pe::image { module.data(), module.size() } };
+
+    REQUIRE(imports.size() == 1);
+    REQUIRE(!imports.find("kernel32.dll", "Sleep"));
+    REQUIRE(imports.find("user32.dll", "MessageBoxA").has_value());
+}
+
+TEST_CASE("Relocation index finds fields overlapping a range", "[pe]")
+{
+    auto const module = test::image_builder { 0x4000 }
+        .section(".text", 0x1000, 0x400, 0x1000)
+        .section(".reloc", 0x3000, 0x2400, 0x1000)
+        .relocations(0x3000, { 0x1010, 0x1020, 0x2008 })
+        .build();
+
+    auto const relocations = pe::relocation_index { pe::image { module.data(), module.size() } };
+
+    REQUIRE(relocations.size() == 3);
+    REQUIRE(relocations.intersects(0x1010, 1));
+    REQUIRE(relocations.intersects(0x1017, 1));
+    REQUIRE(relocations.intersects(0x100C, 8));
+    REQUIRE(!relocations.intersects(0x1018, 8));
+    REQUIRE(!relocations.intersects(0x1000, 0x10));
+    REQUIRE(relocations.intersects(0x1000, 0x11));
+    REQUIRE(relocations.intersects(0x2000, 0x10));
+    REQUIRE(!relocations.intersects(0x2010, 0x100));
+
+    auto const plain = make_module();
+    REQUIRE(pe::relocation_index { pe::image { plain.data(), plain.size() } }.size() == 0);
+}
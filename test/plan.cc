@@ -0,0 +1,133 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "image.h"
+#include "../src/plan.h"
+#include "../src/patch.h"
+
+using namespace mempatcher;
+using test::parse;
+
+namespace
+{
+    auto make_builder()
+    {
+        return test::image_builder { 0x4000 }
+            .section(".text", 0x1000, 0x400, 0x1000)
+            .section(".rdata", 0x2000, 0x1400, 0x800)
+            .write(0x1000, std::vector<std::uint8_t> { 0x74, 0x07, 0x75, 0x32 })
+            .write(0x1100, std::vector<std::uint8_t> { 0x48, 0x8B, 0x05, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 })
+            .exports(0x2000, {
+                { .name = "Update", .rva = 0x1000 },
+                { .name = "Sleep", .forwarder = "KERNELBASE.Sleep" },
+            })
+            .imports(0x2200, { { .library = "kernel32.dll", .names = { "Sleep" } } })
+            .relocations(0x2600, { 0x1104 });
+    }
+}
+
+TEST_CASE("Plans resolve and verify patches from the file on disk", "[plan]")
+{
+    auto const disk = make_builder().build(pe::layout::file);
+    auto const file = pe::image { disk.data(), disk.size(), pe::layout::file };
+
+    auto const patches = std::vector {
+        parse("test.dll 1000 9090 7407"),
+        parse("test.dll F+402 EB 75"),
+        parse("test.dll !Update+1 90 07"),
+        parse("test.dll 1000 9090 7408"),
+        parse("test.dll 1102 CC 05"),
+        parse("test.dll 1104 CC 00"),
+        parse("test.dll iat:kernel32.dll!Sleep 0000000000000000"),
+        parse("test.dll !Sleep 90"),
+        parse("test.dll crc:.text 1A2B3C4D"),
+        parse("test.dll 2900 90 00"),
+        parse("test.dll 3FFF 9090"),
+    };
+
+    auto const plan = plan::prepare(file, patches);
+
+    REQUIRE(plan.build == file.build());
+    REQUIRE(plan.steps.size() == patches.size());
+
+    // resolved and verified against the file
+    REQUIRE(plan.steps[0]->rva == 0x1000);
+    REQUIRE(plan.steps[0]->verified);
+    REQUIRE(plan.steps[1]->rva == 0x1002);
+    REQUIRE(plan.steps[1]->verified);
+
+    // the first line writes over these expected bytes, so the file says nothing about them
+    REQUIRE(plan.steps[2]->rva == 0x1001);
+    REQUIRE(!plan.steps[2]->verified);
+
+    // mismatches are left for the loader callback to report
+    REQUIRE(plan.steps[3]->rva == 0x1000);
+    REQUIRE(!plan.steps[3]->verified);
+
+    // bytes next to a relocated field can be verified, the field itself cannot
+    REQUIRE(plan.steps[4]->verified);
+    REQUIRE(plan.steps[5]->rva == 0x1104);
+    REQUIRE(!plan.steps[5]->verified);
+
+    // import slots are bound on load
+    REQUIRE(plan.steps[6].has_value());
+    REQUIRE(!plan.steps[6]->verified);
+
+    // forwarders and checksums are only resolved on load
+    REQUIRE(!plan.steps[7].has_value());
+    REQUIRE(!plan.steps[8].has_value());
+
+    // past the raw data of a section, and past the end of the image
+    REQUIRE(plan.steps[9].has_value());
+    REQUIRE(!plan.steps[9]->verified);
+    REQUIRE(!plan.steps[10].has_value());
+}
+
+TEST_CASE("Planned steps apply without resolving again", "[plan]")
+{
+    auto const disk = make_builder().build(pe::layout::file);
+    auto module = make_builder().build();
+    auto memory = memory::buffer { module };
+
+    auto const patches = std::vector { parse("test.dll 1000 9090 7407"), parse("test.dll F+402 EB 76") };
+    auto const plan = plan::prepare(pe::image { disk.data(), disk.size(), pe::layout::file }, patches);
+
+    REQUIRE(plan.steps[0]->verified);
+    REQUIRE(!plan.steps[1]->verified);
+
+    // unverified steps are still compared against memory
+    {
+        auto transaction = patch::transaction { memory };
+        transaction.add(module.data(), patches[0], *plan.steps[0]);
+        transaction.add(module.data(), patches[1], *plan.steps[1]);
+
+        REQUIRE(!transaction.prepare());
+        REQUIRE(transaction.failed() == &patches[1]);
+    }
+
+    auto transaction = patch::transaction { memory };
+    transaction.add(module.data(), patches[0], *plan.steps[0]);
+
+    REQUIRE(transaction.prepare());
+    REQUIRE(transaction.commit());
+    REQUIRE(module[0x1000] == 0x90);
+    REQUIRE(module[0x1001] == 0x90);
+}
+
+TEST_CASE("Verified steps are compared again after an earlier write to them", "[plan]")
+{
+    auto module = make_builder().build();
+    auto memory = memory::buffer { module };
+
+    auto const patches = std::vector { parse("test.dll 1000 9090 7407"), parse("test.dll 1001 CC 07") };
+
+    // as if another target's patch for the same module wrote first
+    auto const verified = plan::step { .rva = 0x1001, .verified = true };
+
+    auto transaction = patch::transaction { memory };
+    transaction.add(module.data(), patches[0]);
+    transaction.add(module.data(), patches[1], verified);
+
+    // the same result as without a plan, the second line expects a byte the first one replaced
+    REQUIRE(!transaction.prepare());
+    REQUIRE(transaction.failed() == &patches[1]);
+}
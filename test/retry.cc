@@ -0,0 +1,102 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/retry.h"
+
+using namespace mempatcher;
+
+using ids = std::vector<std::size_t>;
+
+namespace
+{
+    /**
+     * Advance the wheel until a tick, collecting the tick every timer expired on.
+     */
+    auto run_until(retry::timer_wheel& wheel, std::uint64_t until)
+    {
+        auto result = std::vector<std::pair<std::size_t, std::uint64_t>> {};
+        auto expired = ids {};
+
+        while (wheel.now() < until)
+        {
+            wheel.advance(expired);
+
+            for (auto&& id: expired)
+                result.emplace_back(id, wheel.now());
+
+            expired.clear();
+        }
+
+        return result;
+    }
+}
+
+TEST_CASE("Timers expire on the tick they were scheduled for", "[retry]")
+{
+    auto wheel = retry::timer_wheel {};
+    auto const delays = std::vector<std::uint64_t> { 1, 5, 63, 64, 65, 200, 4095, 4096, 4097, 300000 };
+
+    for (auto i = std::size_t {}; i < delays.size(); ++i)
+        wheel.schedule(i, delays[i]);
+
+    REQUIRE(wheel.size() == delays.size());
+
+    auto const fired = run_until(wheel, 300001);
+
+    REQUIRE(fired.size() == delays.size());
+    REQUIRE(wheel.empty());
+
+    for (auto&& [id, tick]: fired)
+        REQUIRE(tick == delays[id]);
+}
+
+TEST_CASE("Thousands of timers are serviced in order", "[retry]")
+{
+    auto wheel = retry::timer_wheel {};
+    auto delays = std::vector<std::uint64_t> {};
+    auto seed = std::uint32_t { 1 };
+
+    for (auto i = std::size_t {}; i < 5000; ++i)
+    {
+        seed = seed * 1664525 + 1013904223;
+        delays.push_back(1 + seed % 20000);
+        wheel.schedule(i, delays.back());
+    }
+
+    auto const fired = run_until(wheel, 20001);
+
+    REQUIRE(fired.size() == delays.size());
+
+    for (auto&& [id, tick]: fired)
+        REQUIRE(tick == delays[id]);
+}
+
+TEST_CASE("Timers scheduled later count from the current tick", "[retry]")
+{
+    auto wheel = retry::timer_wheel {};
+    auto expired = ids {};
+
+    // start just before a higher level span rolls over
+    while (wheel.now() < 4090)
+        wheel.advance(expired);
+
+    REQUIRE(expired.empty());
+
+    wheel.schedule(0, 6);
+    wheel.schedule(1, 70);
+    wheel.schedule(2, 0);
+
+    auto const fired = run_until(wheel, 5000);
+
+    REQUIRE(fired == std::vector<std::pair<std::size_t, std::uint64_t>> { { 2, 4091 }, { 0, 4096 }, { 1, 4160 } });
+}
+
+TEST_CASE("Delays beyond the wheel are clamped", "[retry]")
+{
+    auto wheel = retry::timer_wheel {};
+    wheel.schedule(0, UINT64_MAX);
+
+    auto const fired = run_until(wheel, retry::timer_wheel::max_delay);
+
+    REQUIRE(fired.size() == 1);
+    REQUIRE(fired[0].second == retry::timer_wheel::max_delay);
+}